@@ -0,0 +1,387 @@
+/**
+ * @file piconfc_scenarios.c
+ * @brief End-to-end scenario benchmarks: the reference workload for performance changes.
+ *
+ * Each scenario runs a complete library operation the way an application does, from the first
+ * PN532 command to the result, and reports the p50/p95/p99 latency and the operations per second:
+ *
+ * - idle_poll: `piconfc_tagPresent` with no tag in the field
+ * - badge_read: `piconfc_readNTAGString` of a URL badge that has just arrived
+ * - repeat_read: `piconfc_readNTAGString` of the same badge left in the field
+ * - ntag216_dump: selecting an NTAG216 and reading all of its user memory
+ * - url_write: `piconfc_writeURI` alternating between two URLs
+ * - provisioning: `piconfc_provisionNext` on a stream of blank NTAG213 tags
+ * - foreign_cc_write: `piconfc_NTAG_writeUserData` refusing a tag whose capability container is
+ *   not an NTAG21x's; a failure means the write went ahead
+ *
+ * Host builds (PICONFC_HOST) run against the simulated PN532 of `piconfc_SIM.h` on the virtual clock,
+ * so latencies are those of a 400 kHz I2C PN532 and the runs are repeatable. The host CPU time
+ * spent per operation and the RF commands per operation are reported as well. Results are JSON in
+ * the layout of `piconfc_bench`. With --transport=spi the simulated PN532 is on a 5 MHz SPI bus
+ * instead, and with --transport=seam it sits directly behind the transport seam, the way the Linux
+ * i2c-dev backend plugs in. With --transport=hsu it answers HSU at 921600 baud on a pseudo-terminal
+ * from a thread of its own; that run follows the monotonic clock and takes real time.
+ *
+ * On a Pico the same scenarios run against the real reader on PICONFC_SCENARIO_SDA/SCL, and the
+ * program asks on stdio for the tags it needs. The write scenarios overwrite those tags.
+ *
+ * Usage (host): piconfc_scenarios [--filter=SUBSTRING] [--iterations=N] [--out=FILE] [--transport=i2c|spi|seam|hsu]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "piconfc.h"
+
+#ifdef PICONFC_HOST
+    #include <time.h>
+    #include "piconfc_HOST.h"
+    #include "piconfc_SIM.h"
+    #include "hardware/uart.h"
+#endif
+
+#ifndef PICONFC_SCENARIO_SDA
+    #define PICONFC_SCENARIO_SDA (4)
+#endif
+#ifndef PICONFC_SCENARIO_SCL
+    #define PICONFC_SCENARIO_SCL (5)
+#endif
+
+#define SCENARIO_MAX_ITERATIONS (1000)
+
+typedef enum {
+    SETUP_NO_TAG,       // Nothing in the field
+    SETUP_BADGE,        // An NTAG213 holding a URL
+    SETUP_NTAG216_FULL, // An NTAG216 with all of its user memory in use
+    SETUP_BLANK,        // A writable NTAG213
+    SETUP_FOREIGN_CC,   // A tag whose capability container names no NTAG21x model
+} ScenarioSetup;
+
+typedef struct Scenario Scenario;
+struct Scenario {
+    const char *name;
+    ScenarioSetup setup;
+    int iterations;
+    bool (*run)(const Scenario *scenario, int iteration); // One measured operation
+    void (*before)(int iteration);                        // Unmeasured preparation, such as a tag arriving
+};
+
+static PicoNFCConfig config;
+static PicoNFCProvisionJob job;
+static uint8_t dump[NTAG_MAX_USER_BYTES];
+static uint32_t samples[SCENARIO_MAX_ITERATIONS];
+
+#ifdef PICONFC_HOST
+    static PN532Sim sim;
+    static SimTag tags[2]; // Alternating tags, so a new arrival has a new UID
+#endif
+
+static const char *BADGE_URL = "https://badges.example.com/u/4411-0831";
+
+// ---------------------------------------------------------------------------------------------
+// Scenario operations
+
+static bool scenario_idlePoll(const Scenario *scenario, int iteration) {
+    (void)scenario;
+    (void)iteration;
+    return !piconfc_tagPresent(&config, 100);
+}
+
+static bool scenario_readBadge(const Scenario *scenario, int iteration) {
+    (void)scenario;
+    (void)iteration;
+    char url[64];
+    return piconfc_readNTAGString(&config, 1000, url, sizeof(url)) == (int)strlen(BADGE_URL);
+}
+
+static bool scenario_dump(const Scenario *scenario, int iteration) {
+    (void)scenario;
+    (void)iteration;
+    uint8_t uid[7];
+    uint8_t uid_len;
+    if (!piconfc_PN532_readPassiveTargetID(&config, PN532_BAUD_ISO14443A, uid, &uid_len, 1000)) return false;
+    return piconfc_NTAG_readUserPages(&config, dump, sizeof(dump)) > 0;
+}
+
+static bool scenario_writeURL(const Scenario *scenario, int iteration) {
+    (void)scenario;
+    const char *url = iteration % 2 == 0 ? "https://example.com/menu/today" : "https://example.com/menu/tomorrow";
+    return piconfc_writeURI(&config, 1000, url) >= 0;
+}
+
+// Writing must be refused without touching the tag when the model is not one the library knows
+static bool scenario_foreignWrite(const Scenario *scenario, int iteration) {
+    (void)scenario;
+    (void)iteration;
+    uint8_t uid[7];
+    uint8_t uid_len;
+    if (!piconfc_PN532_readPassiveTargetID(&config, PN532_BAUD_ISO14443A, uid, &uid_len, 1000)) return false;
+    memset(dump, 0, 144);
+    return !piconfc_NTAG_writeUserData(&config, dump, 144);
+}
+
+static bool scenario_provision(const Scenario *scenario, int iteration) {
+    (void)scenario;
+    uint8_t serial[8];
+    for (int i = 0; i < 8; i++) serial[i] = '0' + (iteration >> (4 * (7 - i)) & 0xF);
+    piconfc_provisionSetField(&job, 27, serial, sizeof(serial));
+    return piconfc_provisionNext(&config, &job, 1000);
+}
+
+// ---------------------------------------------------------------------------------------------
+// Tags for each scenario: simulated on a host, asked for on a Pico
+
+#ifdef PICONFC_HOST
+
+// Formats a tag with a UID derived from a number, and optionally an NDEF image
+static void scenario_makeTag(SimTag *tag, uint8_t model, uint32_t number, const uint8_t *image, int len) {
+    uint8_t uid[7] = { 0x04, 0x5A, 0x11, number >> 24, number >> 16, number >> 8, number };
+    piconfc_SIM_formatTag(tag, model, uid);
+    if (image != NULL) memcpy(tag->memory + NTAG_USER_START_PAGE * NTAG_PAGE_SIZE, image, len);
+}
+
+static void scenario_setup(ScenarioSetup setup) {
+    NDEFBuilder builder;
+    static uint8_t image[NTAG_MAX_USER_BYTES];
+    int len = 0;
+
+    switch (setup) {
+        case SETUP_NO_TAG:
+            piconfc_SIM_setTag(&sim, NULL);
+            return;
+        case SETUP_BADGE:
+            piconfc_NDEF_builderInit(&builder, image, sizeof(image));
+            piconfc_NDEF_builderAddURI(&builder, BADGE_URL);
+            len = piconfc_NDEF_builderFinish(&builder);
+            scenario_makeTag(&tags[0], MODEL_NTAG213, 1, image, len);
+            scenario_makeTag(&tags[1], MODEL_NTAG213, 2, image, len);
+            break;
+        case SETUP_NTAG216_FULL: {
+            static uint8_t vcard[840];
+            for (int i = 0; i < (int)sizeof(vcard); i++) vcard[i] = 'A' + i % 26;
+            piconfc_NDEF_builderInit(&builder, image, sizeof(image));
+            piconfc_NDEF_builderAddRecord(&builder, TNF_MIME, (uint8_t *)"text/vcard", 10, NULL, 0, vcard, sizeof(vcard));
+            len = piconfc_NDEF_builderFinish(&builder);
+            scenario_makeTag(&tags[0], MODEL_NTAG216, 3, image, len);
+            break;
+        }
+        case SETUP_BLANK:
+            scenario_makeTag(&tags[0], MODEL_NTAG213, 4, NULL, 0);
+            break;
+        case SETUP_FOREIGN_CC:
+            scenario_makeTag(&tags[0], MODEL_NTAG213, 5, NULL, 0);
+            tags[0].memory[14] = 0x06; // The data area size of a MIFARE Ultralight
+            break;
+    }
+    piconfc_SIM_setTag(&sim, &tags[0]);
+}
+
+// A new badge arrives for every read, alternating between two UIDs
+static void scenario_badgeArrives(int iteration) {
+    piconfc_SIM_setTag(&sim, &tags[iteration % 2]);
+}
+
+// A new blank tag arrives for every provisioning pass
+static void scenario_blankArrives(int iteration) {
+    scenario_makeTag(&tags[iteration % 2], MODEL_NTAG213, 0x100 + iteration, NULL, 0);
+    piconfc_SIM_setTag(&sim, &tags[iteration % 2]);
+}
+
+static uint64_t scenario_cpuNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+#else
+
+static void scenario_setup(ScenarioSetup setup) {
+    static const char *prompts[] = {
+        "Remove all tags from the reader",
+        "Place a tag with the badge URL on the reader (it will be written first)",
+        "Place an NTAG216 on the reader",
+        "Place a writable NTAG213 on the reader (it will be overwritten)",
+        "Place a MIFARE Ultralight, or another tag that is not an NTAG21x, on the reader",
+    };
+    printf("%s\n", prompts[setup]);
+
+    // Wait for the field to match, then give the user a moment to settle the tag
+    bool want_tag = setup != SETUP_NO_TAG;
+    while (piconfc_tagPresent(&config, 500) != want_tag) {}
+    sleep_ms(1000);
+    if (setup == SETUP_BADGE) piconfc_writeURI(&config, 1000, BADGE_URL);
+}
+
+// Tags cannot be swapped on every iteration on hardware: the tag in the field is treated as new
+static void scenario_badgeArrives(int iteration) {
+    (void)iteration;
+}
+
+static void scenario_blankArrives(int iteration) {
+    (void)iteration;
+    job.last_uid_len = 0; // Provision the same tag again
+}
+
+static uint64_t scenario_cpuNs(void) {
+    return 0; // Not separated from the latency on the target
+}
+
+#endif
+
+// ---------------------------------------------------------------------------------------------
+// Measurement and reporting
+
+static int scenario_compare(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Nearest-rank percentile of sorted samples
+static uint32_t scenario_percentile(const uint32_t *sorted, int count, int percent) {
+    int rank = (percent * count + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static void scenario_run(const Scenario *scenario, int iterations, FILE *out, int *count) {
+    uint64_t total_us = 0, cpu_ns = 0;
+    int failures = 0;
+
+    scenario_setup(scenario->setup);
+    #ifdef PICONFC_HOST
+        SimStats start = sim.stats;
+    #endif
+
+    for (int i = 0; i < iterations; i++) {
+        if (scenario->before != NULL) scenario->before(i);
+        uint64_t cpu_start = scenario_cpuNs();
+        uint64_t start_us = to_us_since_boot(get_absolute_time());
+        if (!scenario->run(scenario, i)) failures++;
+        samples[i] = to_us_since_boot(get_absolute_time()) - start_us;
+        cpu_ns += scenario_cpuNs() - cpu_start;
+        total_us += samples[i];
+    }
+
+    qsort(samples, iterations, sizeof(samples[0]), scenario_compare);
+    uint32_t p50 = scenario_percentile(samples, iterations, 50);
+    uint32_t p95 = scenario_percentile(samples, iterations, 95);
+    uint32_t p99 = scenario_percentile(samples, iterations, 99);
+    double ops = total_us > 0 ? iterations * 1e6 / total_us : 0;
+
+    fprintf(stderr, "%-14s %9u %9u %9u us %9.1f ops/s %6.1f us cpu", scenario->name, (unsigned)p50, (unsigned)p95,
+            (unsigned)p99, ops, cpu_ns / 1000.0 / iterations);
+    if (failures > 0) fprintf(stderr, "  %d FAILED", failures);
+    fprintf(stderr, "\n");
+
+    fprintf(out, "%s\n    {\n", (*count)++ == 0 ? "" : ",");
+    fprintf(out, "      \"name\": \"scenario/%s\",\n", scenario->name);
+    fprintf(out, "      \"run_type\": \"iteration\",\n");
+    fprintf(out, "      \"iterations\": %d,\n", iterations);
+    fprintf(out, "      \"real_time\": %.1f,\n", (double)total_us / iterations);
+    fprintf(out, "      \"cpu_time\": %.3f,\n", cpu_ns / 1000.0 / iterations);
+    fprintf(out, "      \"time_unit\": \"us\",\n");
+    fprintf(out, "      \"p50_us\": %u,\n      \"p95_us\": %u,\n      \"p99_us\": %u,\n", (unsigned)p50, (unsigned)p95, (unsigned)p99);
+    fprintf(out, "      \"ops_per_second\": %.2f,\n", ops);
+    #ifdef PICONFC_HOST
+        fprintf(out, "      \"rf_selects_per_op\": %.2f,\n", (double)(sim.stats.selects - start.selects) / iterations);
+        fprintf(out, "      \"rf_reads_per_op\": %.2f,\n", (double)(sim.stats.reads - start.reads) / iterations);
+        fprintf(out, "      \"rf_writes_per_op\": %.2f,\n", (double)(sim.stats.writes - start.writes) / iterations);
+        fprintf(out, "      \"bus_bytes_per_op\": %.1f,\n", (double)(sim.stats.bus_bytes - start.bus_bytes) / iterations);
+    #endif
+    fprintf(out, "      \"failures\": %d\n    }", failures);
+}
+
+static const Scenario scenarios[] = {
+    { "idle_poll", SETUP_NO_TAG, 20, scenario_idlePoll, NULL },
+    { "badge_read", SETUP_BADGE, 200, scenario_readBadge, scenario_badgeArrives },
+    { "repeat_read", SETUP_BADGE, 200, scenario_readBadge, NULL },
+    { "ntag216_dump", SETUP_NTAG216_FULL, 50, scenario_dump, NULL },
+    { "url_write", SETUP_BLANK, 100, scenario_writeURL, NULL },
+    { "provisioning", SETUP_BLANK, 100, scenario_provision, scenario_blankArrives },
+    { "foreign_cc_write", SETUP_FOREIGN_CC, 20, scenario_foreignWrite, NULL },
+};
+
+int main(int argc, char **argv) {
+    const char *filter = NULL;
+    int iterations = 0; // Per-scenario default
+    FILE *out = stdout;
+
+    #ifdef PICONFC_HOST
+        const char *transport_name = "i2c"; // Interface the simulation is reached through
+        for (int i = 1; i < argc; i++) {
+            if (strncmp(argv[i], "--filter=", 9) == 0) {
+                filter = argv[i] + 9;
+            } else if (strncmp(argv[i], "--iterations=", 13) == 0) {
+                iterations = atoi(argv[i] + 13);
+                if (iterations < 1 || iterations > SCENARIO_MAX_ITERATIONS) iterations = SCENARIO_MAX_ITERATIONS;
+            } else if (strncmp(argv[i], "--out=", 6) == 0) {
+                out = fopen(argv[i] + 6, "w");
+                if (out == NULL) {
+                    perror(argv[i] + 6);
+                    return 1;
+                }
+            } else if (strcmp(argv[i], "--transport=i2c") == 0 || strcmp(argv[i], "--transport=spi") == 0 ||
+                       strcmp(argv[i], "--transport=seam") == 0 || strcmp(argv[i], "--transport=hsu") == 0) {
+                transport_name = argv[i] + 12;
+            } else {
+                fprintf(stderr, "usage: %s [--filter=SUBSTRING] [--iterations=N] [--out=FILE] [--transport=i2c|spi|seam|hsu]\n", argv[0]);
+                return 1;
+            }
+        }
+        piconfc_SIM_init(&sim);
+        piconfc_HOST_useVirtualClock(true);
+        i2c_inst_t *bus = piconfc_SIM_i2cBus(&sim);
+        PicoNFCTransport transport;
+        piconfc_SIM_transport(&sim, &transport);
+        bool ok;
+        if (strcmp(transport_name, "seam") == 0) {
+            ok = piconfc_initTransport(&config, &transport);
+        } else if (strcmp(transport_name, "hsu") == 0) {
+            static uart_inst_t uart;
+            char path[64];
+            piconfc_HOST_useVirtualClock(false); // The PN532 is on the other end of a real terminal
+            ok = piconfc_SIM_hsuOpen(&sim, path, sizeof(path)) && piconfc_SIM_hsuStart(&sim) &&
+                 piconfc_HOST_uartOpen(&uart, path) && piconfc_initHSU(&config, &uart, 0, 1, PICONFC_HSU_MAX_BAUD);
+        } else if (strcmp(transport_name, "spi") == 0) {
+            ok = piconfc_initSPI(&config, piconfc_SIM_spiBus(&sim), 2, 3, 4, 5);
+        } else {
+            ok = piconfc_init(&config, bus, PICONFC_SCENARIO_SDA, PICONFC_SCENARIO_SCL);
+        }
+    #else
+        stdio_init_all();
+        sleep_ms(2000); // Time to attach to USB stdio
+        bool ok = piconfc_init(&config, i2c0, PICONFC_SCENARIO_SDA, PICONFC_SCENARIO_SCL);
+    #endif
+
+    if (!ok) {
+        fprintf(stderr, "PN532 not responding\n");
+        return 1;
+    }
+
+    // Provisioning writes a badge record with an 8-digit serial at payload offset 27
+    static const char badge[] = "\x04" "badges.example.com/u/0000-00000000";
+    piconfc_provisionPrepare(&job, TNF_WELLKNOWN, (uint8_t *)"U", 1, (uint8_t *)badge, sizeof(badge) - 1);
+
+    fprintf(stderr, "%-14s %9s %9s %9s\n", "scenario", "p50", "p95", "p99");
+    fprintf(out, "{\n  \"context\": {\n    \"executable\": \"%s\",\n    \"reader\": \"%s\"\n  },\n", argv[0],
+        #ifdef PICONFC_HOST
+            strcmp(transport_name, "seam") == 0 ? "simulated PN532, transport seam" :
+            strcmp(transport_name, "spi") == 0 ? "simulated PN532, SPI 5 MHz" :
+            strcmp(transport_name, "hsu") == 0 ? "simulated PN532, HSU 921600 baud on a pseudo-terminal" : "simulated PN532, I2C 400 kHz"
+        #else
+            "PN532, I2C"
+        #endif
+    );
+    fprintf(out, "  \"benchmarks\": [");
+    int count = 0;
+    for (unsigned i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+        if (filter != NULL && strstr(scenarios[i].name, filter) == NULL) continue;
+        scenario_run(&scenarios[i], iterations > 0 ? iterations : scenarios[i].iterations, out, &count);
+    }
+    fprintf(out, "\n  ]\n}\n");
+    if (out != stdout) fclose(out);
+    #ifdef PICONFC_HOST
+        piconfc_SIM_hsuStop(&sim);
+    #endif
+    return 0;
+}
@@ -0,0 +1,27 @@
+/**
+ * @file hardware/i2c.h
+ * @brief Host stand-in for the Pico SDK I2C driver.
+ *
+ * An `i2c_inst_t` is a bus with its transfers supplied by whatever sits behind it, such as the
+ * simulated PN532 in `piconfc_SIM.h`. The blocking calls keep the Pico SDK signatures and return the
+ * number of bytes transferred, or a negative value on error.
+ */
+
+#ifndef PICONFC_HOST_HARDWARE_I2C_H
+#define PICONFC_HOST_HARDWARE_I2C_H
+
+#include "pico/stdlib.h"
+
+typedef struct i2c_inst i2c_inst_t;
+
+struct i2c_inst {
+    int (*write_blocking)(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop);
+    int (*read_blocking)(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop);
+    void *ctx; // Device behind the bus
+};
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate);
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop);
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop);
+
+#endif /* PICONFC_HOST_HARDWARE_I2C_H */
@@ -0,0 +1,31 @@
+/**
+ * @file hardware/spi.h
+ * @brief Host stand-in for the Pico SDK SPI driver.
+ *
+ * An `spi_inst_t` is a bus with its transfers supplied by whatever sits behind it, such as the
+ * simulated PN532 in `piconfc_SIM.h`. Chip select is a GPIO the stand-in does not see, so a device
+ * treats each `spi_write_read_blocking` call as one transaction; piconfc's SPI backend makes exactly
+ * one call per chip select. Only the full-duplex call is provided, as that is all piconfc uses.
+ */
+
+#ifndef PICONFC_HOST_HARDWARE_SPI_H
+#define PICONFC_HOST_HARDWARE_SPI_H
+
+#include "pico/stdlib.h"
+
+typedef struct spi_inst spi_inst_t;
+
+struct spi_inst {
+    int (*write_read_blocking)(spi_inst_t *spi, const uint8_t *src, uint8_t *dst, size_t len);
+    void *ctx; // Device behind the bus
+};
+
+typedef enum { SPI_CPOL_0 = 0, SPI_CPOL_1 = 1 } spi_cpol_t;
+typedef enum { SPI_CPHA_0 = 0, SPI_CPHA_1 = 1 } spi_cpha_t;
+typedef enum { SPI_LSB_FIRST = 0, SPI_MSB_FIRST = 1 } spi_order_t;
+
+uint spi_init(spi_inst_t *spi, uint baudrate);
+void spi_set_format(spi_inst_t *spi, uint data_bits, spi_cpol_t cpol, spi_cpha_t cpha, spi_order_t order);
+int spi_write_read_blocking(spi_inst_t *spi, const uint8_t *src, uint8_t *dst, size_t len);
+
+#endif /* PICONFC_HOST_HARDWARE_SPI_H */
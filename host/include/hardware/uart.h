@@ -0,0 +1,39 @@
+/**
+ * @file hardware/uart.h
+ * @brief Host stand-in for the Pico SDK UART driver.
+ *
+ * A `uart_inst_t` is a serial device opened with `piconfc_HOST_uartOpen`, such as a USB serial
+ * adapter or the pseudo-terminal of the simulated PN532 in `piconfc_SIM.h`. The device runs raw
+ * (8N1, no echo or line editing) at the rate set with `uart_init` and `uart_set_baudrate`.
+ */
+
+#ifndef PICONFC_HOST_HARDWARE_UART_H
+#define PICONFC_HOST_HARDWARE_UART_H
+
+#include "pico/stdlib.h"
+
+typedef struct uart_inst uart_inst_t;
+
+struct uart_inst {
+    int fd;         // Open serial device, -1 when closed
+    uint baudrate;  // Rate set on the device
+};
+
+uint uart_init(uart_inst_t *uart, uint baudrate);
+uint uart_set_baudrate(uart_inst_t *uart, uint baudrate);
+void uart_write_blocking(uart_inst_t *uart, const uint8_t *src, size_t len);
+bool uart_is_readable(uart_inst_t *uart);
+bool uart_is_readable_within_us(uart_inst_t *uart, uint32_t us);
+char uart_getc(uart_inst_t *uart);
+void uart_tx_wait_blocking(uart_inst_t *uart);
+
+/**
+ * @brief Opens a serial device for use as a UART. Host builds only.
+ *
+ * @param uart Pointer to the UART to open.
+ * @param path Path of the device, such as /dev/ttyUSB0 or a pseudo-terminal.
+ * @return True if the device was opened; false otherwise, with errno set.
+ */
+bool piconfc_HOST_uartOpen(uart_inst_t *uart, const char *path);
+
+#endif /* PICONFC_HOST_HARDWARE_UART_H */
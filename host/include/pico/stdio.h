@@ -0,0 +1,12 @@
+/**
+ * @file pico/stdio.h
+ * @brief Host stand-in for the Pico SDK stdio: the C library's stdio is used directly.
+ */
+
+#ifndef PICONFC_HOST_PICO_STDIO_H
+#define PICONFC_HOST_PICO_STDIO_H
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+
+#endif /* PICONFC_HOST_PICO_STDIO_H */
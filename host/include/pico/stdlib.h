@@ -0,0 +1,41 @@
+/**
+ * @file pico/stdlib.h
+ * @brief Host stand-in for the subset of the Pico SDK stdlib used by piconfc.
+ *
+ * Time comes from `piconfc_HOST.c`, which either follows the monotonic clock or, for simulations,
+ * a virtual clock that only moves when the code sleeps or a simulated device charges bus time.
+ */
+
+#ifndef PICONFC_HOST_PICO_STDLIB_H
+#define PICONFC_HOST_PICO_STDLIB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t; // Microseconds since boot
+
+#define GPIO_FUNC_I2C (3)
+#define GPIO_FUNC_SPI (1)
+#define GPIO_FUNC_UART (2)
+
+#define GPIO_OUT (1)
+#define GPIO_IN (0)
+
+absolute_time_t get_absolute_time(void);
+uint32_t to_ms_since_boot(absolute_time_t t);
+uint64_t to_us_since_boot(absolute_time_t t);
+void sleep_ms(uint32_t ms);
+void sleep_us(uint64_t us);
+
+// Pins have no meaning on a host
+void gpio_set_function(uint gpio, int fn);
+void gpio_pull_up(uint gpio);
+void gpio_init(uint gpio);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_put(uint gpio, bool value);
+
+bool stdio_init_all(void);
+
+#endif /* PICONFC_HOST_PICO_STDLIB_H */
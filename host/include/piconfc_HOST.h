@@ -0,0 +1,42 @@
+/**
+ * @file piconfc_HOST.h
+ * @brief Clock control for host builds of piconfc.
+ *
+ * Host builds replace the Pico SDK with the headers in host/include. By default time follows the
+ * monotonic clock and sleeps really sleep. With the virtual clock enabled, time stands still except
+ * when the library sleeps or a simulated device charges time with `piconfc_HOST_advance`, so a
+ * simulation runs as fast as the host allows and reports the latency the target would see.
+ */
+
+#ifndef PICONFC_HOST_H
+#define PICONFC_HOST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Switches between the monotonic clock and the virtual clock.
+ *
+ * The virtual clock continues from the current time, so timestamps never go backwards.
+ *
+ * @param enable True to use the virtual clock; false to follow the monotonic clock.
+ */
+void piconfc_HOST_useVirtualClock(bool enable);
+
+/**
+ * @brief Moves the virtual clock forward, as a simulated device does for bus and processing time.
+ *
+ * Has no effect while the monotonic clock is in use.
+ *
+ * @param us Microseconds to move forward.
+ */
+void piconfc_HOST_advance(uint64_t us);
+
+/**
+ * @brief Returns the current time in microseconds since the host build started.
+ *
+ * @return The time of the clock in use, the same value as `to_us_since_boot(get_absolute_time())`.
+ */
+uint64_t piconfc_HOST_now(void);
+
+#endif /* PICONFC_HOST_H */
@@ -0,0 +1,57 @@
+/**
+ * @file piconfc_I2CDEV.h
+ * @brief Linux i2c-dev backend, for PN532 readers on Raspberry Pi and other Linux boards.
+ *
+ * The PN532 is reached through /dev/i2c-N with I2C_RDWR transfers, so every status check and frame
+ * read is one bus transaction with the address in the message, and no I2C_SLAVE binding is needed.
+ * Readiness is polled against a CLOCK_MONOTONIC deadline, starting with short intervals so the ACK
+ * and quick responses are picked up well under the millisecond polling of the Pico backend.
+ *
+ * Usage:
+ * @code
+ * I2CDevBus bus;
+ * PicoNFCTransport transport;
+ * PicoNFCConfig config;
+ * if (piconfc_I2CDEV_open(&bus, &transport, "/dev/i2c-1", PN532_I2C_ADDRESS))
+ *     piconfc_initTransport(&config, &transport);
+ * @endcode
+ */
+
+#ifndef PICONFC_I2CDEV_H
+#define PICONFC_I2CDEV_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "piconfc_I2C.h"
+
+#define I2CDEV_POLL_MIN_US (100)  ///< First readiness poll interval
+#define I2CDEV_POLL_MAX_US (1000) ///< Longest readiness poll interval; intervals double up to it
+
+/**
+ * @brief State of an open i2c-dev bus.
+ */
+typedef struct {
+    int fd;            // File descriptor of the i2c-dev device, -1 when closed
+    uint16_t address;  // 7-bit address of the PN532
+    uint32_t polls;    // Status reads made while waiting for readiness
+} I2CDevBus;
+
+/**
+ * @brief Opens an i2c-dev device and sets up a transport to the PN532 on it.
+ *
+ * @param bus Pointer to the bus state, which must outlive the transport and any configuration using it.
+ * @param transport Pointer to the transport to set up, for `piconfc_initTransport`.
+ * @param path Path of the device, such as "/dev/i2c-1".
+ * @param address 7-bit address of the PN532, normally `PN532_I2C_ADDRESS`.
+ * @return True if the device was opened and supports plain I2C transfers; false otherwise, with errno set.
+ */
+bool piconfc_I2CDEV_open(I2CDevBus *bus, PicoNFCTransport *transport, const char *path, uint16_t address);
+
+/**
+ * @brief Closes the device of a bus opened with `piconfc_I2CDEV_open`.
+ *
+ * @param bus Pointer to the bus state.
+ */
+void piconfc_I2CDEV_close(I2CDevBus *bus);
+
+#endif /* PICONFC_I2CDEV_H */
@@ -0,0 +1,265 @@
+/**
+ * @file piconfc_SIM.h
+ * @brief Simulated PN532 with an NTAG21X tag, for host builds of piconfc.
+ *
+ * The simulation answers PN532 frames the way the chip does: it acknowledges each command, stays busy
+ * for the time the command would take on air, and then offers the response. A tag can be placed in
+ * and removed from the field at any time. The core only deals in frames, so it can sit behind any
+ * host interface; `piconfc_SIM_i2cBus` puts it on a host I2C bus, reporting its status byte like the
+ * PN532 does over I2C, `piconfc_SIM_spiBus` on a host SPI bus, with the SPI operation bytes and bit
+ * order, and `piconfc_SIM_transport` puts it directly behind the transport seam. Over HSU it speaks
+ * the byte stream of the PN532 UART on a pseudo-terminal, from `piconfc_SIM_hsuOpen`.
+ *
+ * All timing is charged to the host clock (see `piconfc_HOST.h`), so with the virtual clock enabled
+ * the library sees the latencies it would see on hardware, without waiting for them.
+ */
+
+#ifndef PICONFC_SIM_H
+#define PICONFC_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "hardware/i2c.h"
+#include "hardware/spi.h"
+#include "piconfc_I2C.h"
+
+#define SIM_MAX_PAGES (231)  ///< Pages of an NTAG216, the largest supported tag
+#define SIM_MAX_FRAME (264)  ///< Largest frame the simulation sends or accepts
+#define SIM_HSU_IDLE_US (1000) ///< Quiet HSU line after which a wake-up byte may start a new client
+
+/**
+ * @brief Durations the simulated PN532 charges, in microseconds.
+ *
+ * The defaults from `piconfc_SIM_init` follow the PN532 and NTAG21X data sheets: 106 kbit/s on air
+ * (about 85 us per byte with framing), 4.1 ms to program an NTAG page, a 400 kHz I2C bus and a 5 MHz
+ * SPI bus.
+ */
+typedef struct {
+    uint32_t ack_us;        // From the end of a command frame to the ACK being ready
+    uint32_t command_us;    // Processing of commands that do not use the RF field
+    uint32_t select_us;     // Anticollision and selection of a 7-byte UID tag
+    uint32_t poll_us;       // One passive activation attempt without a tag in the field
+    uint32_t read_us;       // NTAG READ: 16 bytes on air plus turnaround
+    uint32_t write_us;      // NTAG WRITE: command on air plus page programming
+    uint32_t bus_byte_ns;   // Host interface time per byte, including the address byte
+    uint32_t spi_byte_ns;   // SPI time per byte, including the operation byte
+} SimTiming;
+
+/**
+ * @brief A simulated NTAG21X tag.
+ */
+typedef struct {
+    uint8_t uid[7];                           // UID, also stored in pages 0-2
+    uint8_t model;                            // Model byte of the capability container, see enum NTAG21X
+    int pages;                                // Total pages of the model, including configuration pages
+    uint8_t memory[SIM_MAX_PAGES * 4];        // Page memory
+} SimTag;
+
+/**
+ * @brief Counters of what the simulated PN532 did, for checking that an optimization saves RF traffic.
+ */
+typedef struct {
+    uint32_t frames;        // Command frames received
+    uint32_t selects;       // Successful InListPassiveTarget commands
+    uint32_t reads;         // NTAG READ commands
+    uint32_t writes;        // NTAG WRITE commands
+    uint32_t bus_bytes;     // Bytes moved over the host interface, in both directions
+} SimStats;
+
+/**
+ * @brief State of a simulated PN532.
+ */
+typedef struct {
+    SimTiming timing;
+    SimStats stats;
+    SimTag *tag;                    // Tag in the field, or NULL
+    bool selected;                  // Whether the tag in the field has been selected by InListPassiveTarget
+    uint8_t retries;                // MxRtyPassiveActivation, 0xFF retries forever
+    uint8_t pending[SIM_MAX_FRAME]; // ACK or response frame waiting to be read
+    int pending_len;                // Length of pending, 0 when there is nothing to read
+    bool ack_pending;               // Whether pending holds the ACK of the command in progress
+    uint64_t ready_at;              // Host time at which pending becomes readable
+    uint8_t response[SIM_MAX_FRAME];// Response of the command in progress, offered after its ACK
+    int response_len;               // Length of response, 0 if there is none yet
+    uint32_t response_us;           // Time the command takes after its ACK has been read
+    bool waiting_for_tag;           // Whether an InListPassiveTarget is waiting for a tag to arrive
+    i2c_inst_t i2c;                 // Host I2C bus with the simulation behind it
+    spi_inst_t spi;                 // Host SPI bus with the simulation behind it
+    int hsu_fd;                     // Master side of the HSU pseudo-terminal, -1 if none
+    bool hsu_awake;                 // Whether the HSU wake-up preamble has been received
+    uint8_t hsu_rx[SIM_MAX_FRAME];  // HSU bytes received and not yet reassembled into a frame
+    int hsu_rx_len;                 // Number of bytes in hsu_rx
+    uint32_t hsu_baud;              // Rate of the serial interface
+    uint32_t hsu_next_baud;         // Rate from SetSerialBaudRate, taken once the host acknowledges it
+    uint64_t hsu_send_at;           // Host time at which the ready frame has been sent on the wire, 0 if not started
+    uint64_t hsu_last_rx;           // Host time at which HSU bytes were last received
+    bool hsu_wakeup_resets;         // Whether a wake-up on an idle line starts over as after power-up
+    bool hsu_running;               // Whether the thread from piconfc_SIM_hsuStart should keep serving
+    pthread_t hsu_thread;           // Thread from piconfc_SIM_hsuStart
+    pthread_mutex_t lock;           // Held while serving HSU and changing the tag, which may be on different threads
+} PN532Sim;
+
+/**
+ * @brief Initializes a simulated PN532 with default timing and no tag in the field.
+ *
+ * @param sim Pointer to the simulation to initialize.
+ */
+void piconfc_SIM_init(PN532Sim *sim);
+
+/**
+ * @brief Formats a blank tag: UID in pages 0-2, capability container in page 3 and, from page 4,
+ * the factory layout of a Lock Control TLV followed by an empty NDEF TLV.
+ *
+ * @param tag Pointer to the tag to format.
+ * @param model Model byte, one of the enum NTAG21X values.
+ * @param uid Pointer to the 7-byte UID.
+ * @return True if the tag was formatted; false if the model is unknown.
+ */
+bool piconfc_SIM_formatTag(SimTag *tag, uint8_t model, const uint8_t *uid);
+
+/**
+ * @brief Places a tag in the field, or removes the current one with NULL.
+ *
+ * A tag arriving completes an InListPassiveTarget that is waiting for one. Removing the tag
+ * deselects it, so exchanges fail until the next tag is selected.
+ *
+ * @param sim Pointer to the simulation.
+ * @param tag Pointer to the tag, which must outlive its time in the field; NULL for no tag.
+ */
+void piconfc_SIM_setTag(PN532Sim *sim, SimTag *tag);
+
+/**
+ * @brief Passes a frame from the host to the simulated PN532.
+ *
+ * A new command aborts the one in progress, as on the PN532. Invalid frames are ignored.
+ *
+ * @param sim Pointer to the simulation.
+ * @param frame Pointer to the frame, starting with the preamble.
+ * @param len Length of the frame in bytes.
+ */
+void piconfc_SIM_receive(PN532Sim *sim, const uint8_t *frame, int len);
+
+/**
+ * @brief Checks whether the simulated PN532 has a frame ready to be read.
+ *
+ * @param sim Pointer to the simulation.
+ * @return True if an ACK or response frame is ready at the current host time.
+ */
+bool piconfc_SIM_ready(PN532Sim *sim);
+
+/**
+ * @brief Takes the frame that is ready, moving on from the ACK to the response of the command.
+ *
+ * @param sim Pointer to the simulation.
+ * @param dest Pointer to the buffer receiving the frame.
+ * @param destsize Size of the buffer in bytes. A longer frame is truncated.
+ * @return The number of bytes copied, or 0 if no frame is ready.
+ */
+int piconfc_SIM_transmit(PN532Sim *sim, uint8_t *dest, int destsize);
+
+/**
+ * @brief Returns the host I2C bus with the simulated PN532 at its I2C address.
+ *
+ * Reads start with the PN532 status byte: 0x01 followed by the ready frame, or 0x00 while busy.
+ * Every transfer charges `bus_byte_ns` per byte to the host clock.
+ *
+ * @param sim Pointer to the simulation.
+ * @return The bus, to pass to `piconfc_init`.
+ */
+i2c_inst_t *piconfc_SIM_i2cBus(PN532Sim *sim);
+
+/**
+ * @brief Returns the host SPI bus with the simulated PN532 behind it.
+ *
+ * Each transfer is one transaction: an operation byte (status read, data write or data read) and
+ * its data, with every byte least significant bit first as on the PN532. Every transfer charges
+ * `spi_byte_ns` per byte to the host clock.
+ *
+ * @param sim Pointer to the simulation.
+ * @return The bus, to pass to `piconfc_initSPI`.
+ */
+spi_inst_t *piconfc_SIM_spiBus(PN532Sim *sim);
+
+/**
+ * @brief Sets up a transport with the simulated PN532 directly behind it, for `piconfc_initTransport`.
+ *
+ * This is the in-process fake for code written against the transport seam, such as applications
+ * that use the Linux i2c-dev backend on hardware. Transfers charge `bus_byte_ns` per byte.
+ *
+ * @param sim Pointer to the simulation, which must outlive the transport.
+ * @param transport Pointer to the transport to set up.
+ */
+void piconfc_SIM_transport(PN532Sim *sim, PicoNFCTransport *transport);
+
+/**
+ * @brief Passes bytes received over HSU to the simulated PN532.
+ *
+ * The PN532 ignores everything until a 0x55 wake-up byte arrives. After that, bytes are reassembled
+ * into frames and passed to `piconfc_SIM_receive`; an ACK from the host after a SetSerialBaudRate
+ * response switches the rate. Each command frame also charges its time on the wire.
+ *
+ * With `hsu_wakeup_resets` set, a 0x55 wake-up byte that arrives between frames after the line has
+ * been idle for `SIM_HSU_IDLE_US` resets the link with `piconfc_SIM_hsuReset` first. A client that
+ * is already talking never sends one, since its frames start with a 0x00 preamble, so this lets
+ * clients take turns on one terminal, each starting from a PN532 as after power-up.
+ *
+ * @param sim Pointer to the simulation.
+ * @param bytes Pointer to the bytes received.
+ * @param len Number of bytes.
+ */
+void piconfc_SIM_hsuReceive(PN532Sim *sim, const uint8_t *bytes, int len);
+
+/**
+ * @brief Returns the HSU link to its state after power-up.
+ *
+ * The PN532 is asleep at 115200 baud, with no partly received frame, no frame waiting to be read
+ * and no command in progress. The tag in the field stays.
+ *
+ * @param sim Pointer to the simulation.
+ */
+void piconfc_SIM_hsuReset(PN532Sim *sim);
+
+/**
+ * @brief Opens a pseudo-terminal for the simulated PN532 to speak HSU on.
+ *
+ * The host side opens the returned path as its serial device, with `piconfc_HOST_uartOpen` or any
+ * other serial code. Call `piconfc_SIM_hsuService` or `piconfc_SIM_hsuStart` to answer on it.
+ *
+ * @param sim Pointer to the simulation.
+ * @param path Pointer to the buffer receiving the path of the terminal for the host side.
+ * @param pathsize Size of the path buffer in bytes.
+ * @return True if the pseudo-terminal was opened; false otherwise.
+ */
+bool piconfc_SIM_hsuOpen(PN532Sim *sim, char *path, int pathsize);
+
+/**
+ * @brief Serves the HSU pseudo-terminal once: takes the bytes received and sends the frame that is ready.
+ *
+ * Over HSU the PN532 sends each frame as soon as it is ready, once it has been on the wire for as
+ * long as its bytes take at the current rate. Never blocks.
+ *
+ * @param sim Pointer to the simulation.
+ * @return Microseconds until the next frame is due, to wait for in poll(); -1 if no frame is pending.
+ */
+int piconfc_SIM_hsuService(PN532Sim *sim);
+
+/**
+ * @brief Serves the HSU pseudo-terminal from a background thread until `piconfc_SIM_hsuStop`.
+ *
+ * The tag may be changed from another thread with `piconfc_SIM_setTag` meanwhile. Time must follow
+ * the monotonic clock, since the host side waits on a real device.
+ *
+ * @param sim Pointer to the simulation, opened with `piconfc_SIM_hsuOpen`.
+ * @return True if the thread was started.
+ */
+bool piconfc_SIM_hsuStart(PN532Sim *sim);
+
+/**
+ * @brief Stops the thread from `piconfc_SIM_hsuStart` and closes the pseudo-terminal.
+ *
+ * @param sim Pointer to the simulation.
+ */
+void piconfc_SIM_hsuStop(PN532Sim *sim);
+
+#endif /* PICONFC_SIM_H */
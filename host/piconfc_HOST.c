@@ -0,0 +1,200 @@
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "hardware/spi.h"
+#include "hardware/uart.h"
+#include "piconfc_HOST.h"
+
+static bool virtual_clock = false;
+static uint64_t virtual_us = 0;  // Time of the virtual clock
+static uint64_t boot_ns = 0;     // Monotonic time of the first clock read, as the boot time
+
+static uint64_t host_monotonicUs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t ns = (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+    if (boot_ns == 0) boot_ns = ns;
+    return (ns - boot_ns) / 1000;
+}
+
+void piconfc_HOST_useVirtualClock(bool enable) {
+    // Continue from the current time in either direction
+    if (enable && !virtual_clock) virtual_us = host_monotonicUs();
+    if (!enable && virtual_clock) boot_ns -= (int64_t)(virtual_us - host_monotonicUs()) * 1000;
+    virtual_clock = enable;
+}
+
+void piconfc_HOST_advance(uint64_t us) {
+    if (virtual_clock) virtual_us += us;
+}
+
+uint64_t piconfc_HOST_now(void) {
+    return virtual_clock ? virtual_us : host_monotonicUs();
+}
+
+absolute_time_t get_absolute_time(void) {
+    return piconfc_HOST_now();
+}
+
+uint32_t to_ms_since_boot(absolute_time_t t) {
+    return t / 1000;
+}
+
+uint64_t to_us_since_boot(absolute_time_t t) {
+    return t;
+}
+
+void sleep_us(uint64_t us) {
+    if (virtual_clock) {
+        virtual_us += us;
+        return;
+    }
+    struct timespec ts = { us / 1000000, (us % 1000000) * 1000 };
+    while (nanosleep(&ts, &ts) != 0) {} // Resume after signals
+}
+
+void sleep_ms(uint32_t ms) {
+    sleep_us((uint64_t)ms * 1000);
+}
+
+void gpio_set_function(uint gpio, int fn) {
+    (void)gpio;
+    (void)fn;
+}
+
+void gpio_pull_up(uint gpio) {
+    (void)gpio;
+}
+
+void gpio_init(uint gpio) {
+    (void)gpio;
+}
+
+void gpio_set_dir(uint gpio, bool out) {
+    (void)gpio;
+    (void)out;
+}
+
+void gpio_put(uint gpio, bool value) {
+    (void)gpio;
+    (void)value;
+}
+
+bool stdio_init_all(void) {
+    return true;
+}
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate) {
+    (void)i2c;
+    return baudrate; // The bus runs at whatever speed its device simulates
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop) {
+    if (i2c == NULL || i2c->write_blocking == NULL) return -1;
+    return i2c->write_blocking(i2c, addr, src, len, nostop);
+}
+
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop) {
+    if (i2c == NULL || i2c->read_blocking == NULL) return -1;
+    return i2c->read_blocking(i2c, addr, dst, len, nostop);
+}
+
+uint spi_init(spi_inst_t *spi, uint baudrate) {
+    (void)spi;
+    return baudrate; // The bus runs at whatever speed its device simulates
+}
+
+void spi_set_format(spi_inst_t *spi, uint data_bits, spi_cpol_t cpol, spi_cpha_t cpha, spi_order_t order) {
+    (void)spi;
+    (void)data_bits;
+    (void)cpol;
+    (void)cpha;
+    (void)order;
+}
+
+int spi_write_read_blocking(spi_inst_t *spi, const uint8_t *src, uint8_t *dst, size_t len) {
+    if (spi == NULL || spi->write_read_blocking == NULL) return -1;
+    return spi->write_read_blocking(spi, src, dst, len);
+}
+
+// Termios speed for a rate, or 0 if the host has none
+static speed_t host_speed(uint baudrate) {
+    switch (baudrate) {
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+        #ifdef B460800
+            case 460800: return B460800;
+        #endif
+        #ifdef B921600
+            case 921600: return B921600;
+        #endif
+        default: return 0;
+    }
+}
+
+bool piconfc_HOST_uartOpen(uart_inst_t *uart, const char *path) {
+    uart->fd = open(path, O_RDWR | O_NOCTTY);
+    uart->baudrate = 0;
+    return uart->fd >= 0;
+}
+
+uint uart_init(uart_inst_t *uart, uint baudrate) {
+    struct termios tio;
+    if (tcgetattr(uart->fd, &tio) == 0) {
+        cfmakeraw(&tio); // 8N1, no echo, no line editing or translation
+        tio.c_cflag |= CLOCAL | CREAD;
+        tio.c_cc[VMIN] = 1;
+        tio.c_cc[VTIME] = 0;
+        tcsetattr(uart->fd, TCSANOW, &tio);
+    }
+    return uart_set_baudrate(uart, baudrate);
+}
+
+uint uart_set_baudrate(uart_inst_t *uart, uint baudrate) {
+    struct termios tio;
+    speed_t speed = host_speed(baudrate);
+    if (speed == 0 || tcgetattr(uart->fd, &tio) != 0) return uart->baudrate; // Rate unchanged
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    tcsetattr(uart->fd, TCSADRAIN, &tio);
+    uart->baudrate = baudrate;
+    return baudrate;
+}
+
+void uart_write_blocking(uart_inst_t *uart, const uint8_t *src, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(uart->fd, src, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return; // The device is gone
+        src += n;
+        len -= n;
+    }
+}
+
+bool uart_is_readable_within_us(uart_inst_t *uart, uint32_t us) {
+    struct pollfd pfd = { .fd = uart->fd, .events = POLLIN };
+    return poll(&pfd, 1, (us + 999) / 1000) > 0 && (pfd.revents & POLLIN);
+}
+
+bool uart_is_readable(uart_inst_t *uart) {
+    return uart_is_readable_within_us(uart, 0);
+}
+
+char uart_getc(uart_inst_t *uart) {
+    char c = 0;
+    while (read(uart->fd, &c, 1) < 0 && errno == EINTR) {}
+    return c;
+}
+
+void uart_tx_wait_blocking(uart_inst_t *uart) {
+    tcdrain(uart->fd);
+}
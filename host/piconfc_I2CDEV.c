@@ -0,0 +1,101 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+#include "piconfc_I2CDEV.h"
+#include "piconfc_PN532.h"
+
+#ifdef I2C_DEBUG
+    #include <stdio.h>
+#endif
+
+// Runs a single I2C message as one combined transaction
+static bool i2cdev_transfer(I2CDevBus *bus, uint16_t flags, uint8_t *data, int len) {
+    struct i2c_msg msg = { .addr = bus->address, .flags = flags, .len = len, .buf = data };
+    struct i2c_rdwr_ioctl_data xfer = { .msgs = &msg, .nmsgs = 1 };
+    return ioctl(bus->fd, I2C_RDWR, &xfer) == 1;
+}
+
+static bool i2cdev_isready(PicoNFCTransport *transport) {
+    I2CDevBus *bus = transport->ctx;
+    uint8_t rdy = 0;
+    return i2cdev_transfer(bus, I2C_M_RD, &rdy, 1) && rdy == PN532_I2C_READY;
+}
+
+static bool i2cdev_write(PicoNFCTransport *transport, const uint8_t *data, int len) {
+    I2CDevBus *bus = transport->ctx;
+    return i2cdev_transfer(bus, 0, (uint8_t *)data, len);
+}
+
+static bool i2cdev_read(PicoNFCTransport *transport, uint8_t *data, int len) {
+    I2CDevBus *bus = transport->ctx;
+    uint8_t rbuff[len + 1]; // +1 for leading RDY byte
+
+    // Status byte and frame in one transaction; a busy status means there is no frame yet
+    if (!i2cdev_transfer(bus, I2C_M_RD, rbuff, len + 1) || rbuff[0] != PN532_I2C_READY) return false;
+    memcpy(data, rbuff + 1, len);
+    return true;
+}
+
+static uint64_t i2cdev_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+
+static bool i2cdev_waitready(PicoNFCTransport *transport, int timeout_ms) {
+    I2CDevBus *bus = transport->ctx;
+    uint64_t deadline = timeout_ms > 0 ? i2cdev_now() + (uint64_t)timeout_ms * 1000 : UINT64_MAX;
+    uint32_t interval = I2CDEV_POLL_MIN_US;
+
+    while (true) {
+        bus->polls++;
+        if (i2cdev_isready(transport)) return true;
+
+        // Sleep until the next poll, but never past the deadline
+        uint64_t now = i2cdev_now();
+        if (now >= deadline) break;
+        uint64_t wake = now + interval < deadline ? now + interval : deadline;
+        struct timespec ts = { wake / 1000000, (wake % 1000000) * 1000 };
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+        if (interval < I2CDEV_POLL_MAX_US) interval *= 2;
+    }
+
+    #ifdef I2C_DEBUG
+        printf("TIMEOUT after %d ms\n", timeout_ms);
+    #endif
+    return false;
+}
+
+bool piconfc_I2CDEV_open(I2CDevBus *bus, PicoNFCTransport *transport, const char *path, uint16_t address) {
+    bus->address = address;
+    bus->polls = 0;
+    bus->fd = open(path, O_RDWR | O_CLOEXEC);
+    if (bus->fd < 0) return false;
+
+    // I2C_RDWR needs an adapter that does plain I2C transfers, not only SMBus
+    unsigned long funcs = 0;
+    if (ioctl(bus->fd, I2C_FUNCS, &funcs) < 0 || !(funcs & I2C_FUNC_I2C)) {
+        int err = funcs & I2C_FUNC_I2C ? errno : EOPNOTSUPP;
+        piconfc_I2CDEV_close(bus);
+        errno = err;
+        return false;
+    }
+
+    transport->isready = i2cdev_isready;
+    transport->write = i2cdev_write;
+    transport->read = i2cdev_read;
+    transport->waitready = i2cdev_waitready;
+    transport->ctx = bus;
+    return true;
+}
+
+void piconfc_I2CDEV_close(I2CDevBus *bus) {
+    if (bus->fd >= 0) close(bus->fd);
+    bus->fd = -1;
+}
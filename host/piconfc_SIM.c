@@ -0,0 +1,542 @@
+#define _GNU_SOURCE // posix_openpt and friends
+
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include "piconfc_SIM.h"
+#include "piconfc_HOST.h"
+#include "piconfc_PN532.h"
+#include "piconfc_NTAG.h"
+#include "piconfc_FRAME.h"
+
+#ifdef SIM_DEBUG
+    #include <stdio.h>
+#endif
+
+static const uint8_t SIM_ACK[] = { 0x00, 0x00, 0xFF, 0x00, 0xFF, 0x00 };
+
+#define SIM_STATUS_OK (0x00)      // InDataExchange status: success
+#define SIM_STATUS_TIMEOUT (0x01) // InDataExchange status: the target did not answer (or NAKed)
+
+void piconfc_SIM_init(PN532Sim *sim) {
+    memset(sim, 0, sizeof(*sim));
+    sim->timing.ack_us = 500;
+    sim->timing.command_us = 1000;
+    sim->timing.select_us = 4000;     // REQA, two cascade levels and SELECT
+    sim->timing.poll_us = 1500;
+    sim->timing.read_us = 2000;       // 4-byte command, 18-byte response at ~85 us per byte
+    sim->timing.write_us = 5000;      // 8-byte command, 4.1 ms programming, ACK
+    sim->timing.bus_byte_ns = 22500;  // 9 clocks per byte at 400 kHz
+    sim->timing.spi_byte_ns = 1600;   // 8 clocks per byte at 5 MHz
+    sim->retries = 0xFF;              // The PN532 default: retry forever
+    sim->hsu_fd = -1;
+    sim->hsu_baud = 115200;           // HSU starts at 115200 baud
+    pthread_mutex_init(&sim->lock, NULL);
+}
+
+bool piconfc_SIM_formatTag(SimTag *tag, uint8_t model, const uint8_t *uid) {
+    switch (model) {
+        case MODEL_NTAG213: tag->pages = 45; break;
+        case MODEL_NTAG215: tag->pages = 135; break;
+        case MODEL_NTAG216: tag->pages = 231; break;
+        default: return false;
+    }
+    memset(tag->memory, 0, sizeof(tag->memory));
+    memcpy(tag->uid, uid, 7);
+    tag->model = model;
+
+    // UID with its check bytes, as in pages 0-2 of a real tag
+    tag->memory[0] = uid[0];
+    tag->memory[1] = uid[1];
+    tag->memory[2] = uid[2];
+    tag->memory[3] = 0x88 ^ uid[0] ^ uid[1] ^ uid[2];
+    memcpy(tag->memory + 4, uid + 3, 4);
+    tag->memory[8] = uid[3] ^ uid[4] ^ uid[5] ^ uid[6];
+
+    // Capability container, then the factory layout: a Lock Control TLV and an empty NDEF message
+    const uint8_t cc[] = { 0xE1, 0x10, model, 0x00 };
+    memcpy(tag->memory + 12, cc, 4);
+    const uint8_t factory[] = { NDEF_TLV_LOCK_CONTROL, 0x03, 0xA0, 0x0C, 0x34, NDEF_TLV_NDEF, 0x00, NDEF_TLV_TERMINATOR };
+    memcpy(tag->memory + 16, factory, sizeof(factory));
+    return true;
+}
+
+// Wraps response data in a PN532-to-host frame
+static int sim_frame(uint8_t *frame, const uint8_t *data, int len) {
+    uint8_t sum = PN532_PN532TOHOST;
+    frame[0] = PN532_PREAMBLE;
+    frame[1] = PN532_STARTCODE1;
+    frame[2] = PN532_STARTCODE2;
+    frame[3] = len + 1;
+    frame[4] = ~(len + 1) + 1;
+    frame[5] = PN532_PN532TOHOST;
+    for (int i = 0; i < len; i++) {
+        frame[6 + i] = data[i];
+        sum += data[i];
+    }
+    frame[6 + len] = ~sum + 1;
+    frame[7 + len] = PN532_POSTAMBLE;
+    return len + PN532_FRAME_OVERHEAD;
+}
+
+// Sets the response of the command in progress and how long the command takes after its ACK
+static void sim_respond(PN532Sim *sim, const uint8_t *data, int len, uint32_t us) {
+    sim->response_len = sim_frame(sim->response, data, len);
+    sim->response_us = us;
+}
+
+// Answers InListPassiveTarget with the tag in the field
+static void sim_selectTag(PN532Sim *sim) {
+    uint8_t data[14] = {
+        PN532_RESPONSE_INLISTPASSIVETARGET,
+        1,          // Targets found
+        1,          // Target number
+        0x00, 0x44, // ATQA of an NTAG21X
+        0x00,       // SAK
+        7           // UID length
+    };
+    memcpy(data + 7, sim->tag->uid, 7);
+    sim->selected = true;
+    sim->stats.selects++;
+    sim_respond(sim, data, sizeof(data), sim->timing.select_us);
+}
+
+// Runs an NTAG command from InDataExchange against the tag in the field
+static void sim_exchange(PN532Sim *sim, const uint8_t *cmd, int len) {
+    uint8_t data[2 + SIM_MAX_FRAME - 16] = { PN532_RESPONSE_INDATAEXCHANGE, SIM_STATUS_TIMEOUT };
+    SimTag *tag = sim->tag;
+
+    // Without a selected tag the PN532 times out waiting for an answer
+    if (tag == NULL || !sim->selected || len < 1) {
+        sim_respond(sim, data, 2, sim->timing.read_us);
+        return;
+    }
+
+    if (cmd[0] == NXP_CMD_READ && len >= 2) {
+        // 4 pages, rolling over to page 0 past the end of memory
+        sim->stats.reads++;
+        if (cmd[1] < tag->pages) {
+            for (int i = 0; i < 16; i++) data[2 + i] = tag->memory[(cmd[1] * 4 + i) % (tag->pages * 4)];
+            data[1] = SIM_STATUS_OK;
+            sim_respond(sim, data, 18, sim->timing.read_us);
+            return;
+        }
+    } else if (cmd[0] == NXP_CMD_FASTREAD && len >= 3) {
+        // A run of pages, on air for as long as its bytes take
+        sim->stats.reads++;
+        int count = (cmd[2] - cmd[1] + 1) * 4;
+        if (cmd[2] >= cmd[1] && cmd[2] < tag->pages && count <= (int)sizeof(data) - 2) {
+            memcpy(data + 2, tag->memory + cmd[1] * 4, count);
+            data[1] = SIM_STATUS_OK;
+            sim_respond(sim, data, 2 + count, sim->timing.read_us * (count + 6) / 22);
+            return;
+        }
+    } else if ((cmd[0] == NXP_ULTRALIGHT_CMD_WRITE || cmd[0] == NXP_CMD_WRITE) && len >= 6) {
+        // UID pages are read-only; lock bits and the capability container are one-time programmable
+        sim->stats.writes++;
+        uint8_t page = cmd[1];
+        if (page >= 2 && page < tag->pages) {
+            uint8_t *dest = tag->memory + page * 4;
+            for (int i = 0; i < 4; i++) {
+                if (page == 3 || (page == 2 && i >= 2)) dest[i] |= cmd[2 + i];
+                else if (page != 2) dest[i] = cmd[2 + i];
+            }
+            data[1] = SIM_STATUS_OK;
+            sim_respond(sim, data, 2, sim->timing.write_us);
+            return;
+        }
+    } else if (cmd[0] == NXP_CMD_GET_VERSION) {
+        // Vendor NXP, NTAG, storage size by model
+        uint8_t size = tag->model == MODEL_NTAG213 ? 0x0F : tag->model == MODEL_NTAG215 ? 0x11 : 0x13;
+        const uint8_t version[] = { 0x00, 0x04, 0x04, 0x02, 0x01, 0x00, size, 0x03 };
+        memcpy(data + 2, version, sizeof(version));
+        data[1] = SIM_STATUS_OK;
+        sim_respond(sim, data, 2 + sizeof(version), sim->timing.read_us);
+        return;
+    }
+
+    // Unknown commands and addresses out of range are NAKed by the tag
+    sim_respond(sim, data, 2, sim->timing.read_us);
+}
+
+void piconfc_SIM_receive(PN532Sim *sim, const uint8_t *frame, int len) {
+    // Only normal information frames from the host carry commands
+    if (len < PN532_FRAME_OVERHEAD + 1 || frame[0] != PN532_PREAMBLE || frame[1] != PN532_STARTCODE1 || frame[2] != PN532_STARTCODE2) return;
+    uint8_t datalen = frame[3];
+    if ((uint8_t)(datalen + frame[4]) != 0 || datalen < 2 || 6 + datalen > len || frame[5] != PN532_HOSTTOPN532) return;
+    uint8_t sum = 0;
+    for (int i = 0; i <= datalen; i++) sum += frame[5 + i];
+    if (sum != 0) return;
+
+    const uint8_t *cmd = frame + 6;
+    int cmdlen = datalen - 1;
+    sim->stats.frames++;
+
+    #ifdef SIM_DEBUG
+        printf("sim: command %02X, %d bytes\n", cmd[0], cmdlen);
+    #endif
+
+    // A new command aborts the one in progress; the ACK comes first
+    memcpy(sim->pending, SIM_ACK, sizeof(SIM_ACK));
+    sim->pending_len = sizeof(SIM_ACK);
+    sim->ack_pending = true;
+    sim->ready_at = piconfc_HOST_now() + sim->timing.ack_us;
+    sim->response_len = 0;
+    sim->waiting_for_tag = false;
+
+    uint8_t data[8] = { cmd[0] + 1 }; // Responses carry the command code plus one
+    switch (cmd[0]) {
+        case PN532_COMMAND_GETFIRMWAREVERSION: {
+            const uint8_t version[] = { cmd[0] + 1, 0x32, 0x01, 0x06, 0x07 }; // PN532 v1.6, all protocols
+            sim_respond(sim, version, sizeof(version), sim->timing.command_us);
+            break;
+        }
+        case PN532_COMMAND_RFCONFIGURATION:
+            if (cmdlen >= 5 && cmd[1] == 0x05) sim->retries = cmd[4]; // MxRtyPassiveActivation
+            sim_respond(sim, data, 1, sim->timing.command_us);
+            break;
+        case PN532_COMMAND_INLISTPASSIVETARGET:
+            sim->selected = false;
+            if (sim->tag != NULL) {
+                sim_selectTag(sim);
+            } else if (sim->retries != 0xFF) {
+                data[1] = 0; // No target after the last retry
+                sim_respond(sim, data, 2, (sim->retries + 1) * sim->timing.poll_us);
+            } else {
+                sim->waiting_for_tag = true; // Answered once a tag arrives
+            }
+            break;
+        case PN532_COMMAND_INDATAEXCHANGE:
+            sim_exchange(sim, cmd + 2, cmdlen - 2);
+            break;
+        case PN532_COMMAND_INRELEASE:
+        case PN532_COMMAND_INDESELECT:
+            sim->selected = false;
+            data[1] = SIM_STATUS_OK;
+            sim_respond(sim, data, 2, sim->timing.command_us);
+            break;
+        case PN532_COMMAND_SETSERIALBAUDRATE: {
+            // Taken once the host acknowledges the response
+            static const uint32_t rates[] = { 9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600, 1288000 };
+            if (cmdlen >= 2 && cmd[1] < sizeof(rates) / sizeof(rates[0])) sim->hsu_next_baud = rates[cmd[1]];
+            sim_respond(sim, data, 1, sim->timing.command_us);
+            break;
+        }
+        case PN532_COMMAND_SAMCONFIGURATION:
+        default:
+            // Commands the simulation does not model are acknowledged without side effects
+            sim_respond(sim, data, 1, sim->timing.command_us);
+            break;
+    }
+}
+
+static void sim_setTag(PN532Sim *sim, SimTag *tag) {
+    sim->tag = tag;
+    sim->selected = false;
+    if (tag == NULL || !sim->waiting_for_tag) return;
+
+    // Complete the InListPassiveTarget waiting for a tag, counting from now
+    sim->waiting_for_tag = false;
+    sim_selectTag(sim);
+    if (!sim->ack_pending) {
+        memcpy(sim->pending, sim->response, sim->response_len);
+        sim->pending_len = sim->response_len;
+        sim->ready_at = piconfc_HOST_now() + sim->response_us;
+        sim->response_len = 0;
+    }
+}
+
+void piconfc_SIM_setTag(PN532Sim *sim, SimTag *tag) {
+    pthread_mutex_lock(&sim->lock);
+    sim_setTag(sim, tag);
+    pthread_mutex_unlock(&sim->lock);
+}
+
+bool piconfc_SIM_ready(PN532Sim *sim) {
+    return sim->pending_len > 0 && piconfc_HOST_now() >= sim->ready_at;
+}
+
+int piconfc_SIM_transmit(PN532Sim *sim, uint8_t *dest, int destsize) {
+    if (!piconfc_SIM_ready(sim)) return 0;
+    int len = sim->pending_len < destsize ? sim->pending_len : destsize;
+    memcpy(dest, sim->pending, len);
+    sim->pending_len = 0;
+
+    // Once the ACK has been read the command runs, and its response follows
+    if (sim->ack_pending) {
+        sim->ack_pending = false;
+        if (sim->response_len > 0) {
+            memcpy(sim->pending, sim->response, sim->response_len);
+            sim->pending_len = sim->response_len;
+            sim->ready_at = piconfc_HOST_now() + sim->response_us;
+            sim->response_len = 0;
+        }
+    }
+    return len;
+}
+
+static int sim_i2cWrite(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop) {
+    PN532Sim *sim = i2c->ctx;
+    (void)nostop; // Every transfer ends with a stop on the simulated bus
+    if (addr != PN532_I2C_ADDRESS) return -1; // No device at the address
+
+    sim->stats.bus_bytes += len;
+    piconfc_HOST_advance(((uint64_t)len + 1) * sim->timing.bus_byte_ns / 1000);
+    piconfc_SIM_receive(sim, src, len);
+    return len;
+}
+
+static int sim_i2cRead(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop) {
+    PN532Sim *sim = i2c->ctx;
+    (void)nostop; // Every transfer ends with a stop on the simulated bus
+    if (addr != PN532_I2C_ADDRESS) return -1; // No device at the address
+
+    // The status byte is sampled at the start of the transfer
+    memset(dst, 0, len);
+    if (len > 0 && piconfc_SIM_ready(sim)) {
+        dst[0] = PN532_I2C_READY;
+        if (len > 1) piconfc_SIM_transmit(sim, dst + 1, len - 1); // Reading past the status byte consumes the frame
+    }
+    sim->stats.bus_bytes += len;
+    piconfc_HOST_advance(((uint64_t)len + 1) * sim->timing.bus_byte_ns / 1000);
+    return len;
+}
+
+i2c_inst_t *piconfc_SIM_i2cBus(PN532Sim *sim) {
+    sim->i2c.write_blocking = sim_i2cWrite;
+    sim->i2c.read_blocking = sim_i2cRead;
+    sim->i2c.ctx = sim;
+    return &sim->i2c;
+}
+
+// Reverses the bits of a byte, as the PN532 shifts SPI bytes LSB first
+static uint8_t sim_reverse(uint8_t b) {
+    b = (b & 0xF0) >> 4 | (b & 0x0F) << 4;
+    b = (b & 0xCC) >> 2 | (b & 0x33) << 2;
+    b = (b & 0xAA) >> 1 | (b & 0x55) << 1;
+    return b;
+}
+
+static int sim_spiTransfer(spi_inst_t *spi, const uint8_t *src, uint8_t *dst, size_t len) {
+    PN532Sim *sim = spi->ctx;
+    uint8_t data[SIM_MAX_FRAME] = { 0 };
+    int datalen = len > sizeof(data) + 1 ? (int)sizeof(data) : (int)len - 1;
+
+    // Nothing is shifted out while the operation byte comes in
+    memset(dst, 0, len);
+    if (len > 0) {
+        switch (sim_reverse(src[0])) {
+            case PN532_SPI_STATREAD:
+                data[0] = piconfc_SIM_ready(sim) ? PN532_SPI_READY : 0x00;
+                if (len > 1) dst[1] = sim_reverse(data[0]);
+                break;
+            case PN532_SPI_DATAWRITE:
+                for (int i = 0; i < datalen; i++) data[i] = sim_reverse(src[1 + i]);
+                piconfc_SIM_receive(sim, data, datalen);
+                break;
+            case PN532_SPI_DATAREAD:
+                // Reading while busy clocks out zeros; otherwise the read consumes the frame
+                if (piconfc_SIM_ready(sim)) piconfc_SIM_transmit(sim, data, datalen);
+                for (int i = 0; i < datalen; i++) dst[1 + i] = sim_reverse(data[i]);
+                break;
+        }
+    }
+    sim->stats.bus_bytes += len;
+    piconfc_HOST_advance((uint64_t)len * sim->timing.spi_byte_ns / 1000);
+    return len;
+}
+
+spi_inst_t *piconfc_SIM_spiBus(PN532Sim *sim) {
+    sim->spi.write_read_blocking = sim_spiTransfer;
+    sim->spi.ctx = sim;
+    return &sim->spi;
+}
+
+static bool sim_transportIsready(PicoNFCTransport *transport) {
+    return piconfc_SIM_ready(transport->ctx);
+}
+
+static bool sim_transportWrite(PicoNFCTransport *transport, const uint8_t *data, int len) {
+    PN532Sim *sim = transport->ctx;
+    sim->stats.bus_bytes += len;
+    piconfc_HOST_advance((uint64_t)len * sim->timing.bus_byte_ns / 1000);
+    piconfc_SIM_receive(sim, data, len);
+    return true;
+}
+
+static bool sim_transportRead(PicoNFCTransport *transport, uint8_t *data, int len) {
+    PN532Sim *sim = transport->ctx;
+    memset(data, 0, len);
+    int n = piconfc_SIM_transmit(sim, data, len);
+    sim->stats.bus_bytes += len;
+    piconfc_HOST_advance((uint64_t)len * sim->timing.bus_byte_ns / 1000);
+    return n > 0;
+}
+
+void piconfc_SIM_transport(PN532Sim *sim, PicoNFCTransport *transport) {
+    transport->isready = sim_transportIsready;
+    transport->write = sim_transportWrite;
+    transport->read = sim_transportRead;
+    transport->waitready = NULL; // Polled every millisecond on the host clock
+    transport->ctx = sim;
+}
+
+// Time a number of bytes take on the serial wire: a start bit, 8 data bits and a stop bit each
+static uint64_t sim_hsuWireUs(PN532Sim *sim, int bytes) {
+    return (uint64_t)bytes * 10 * 1000000 / sim->hsu_baud;
+}
+
+void piconfc_SIM_hsuReset(PN532Sim *sim) {
+    sim->hsu_awake = false;
+    sim->hsu_rx_len = 0;
+    sim->hsu_baud = 115200;
+    sim->hsu_next_baud = 0;
+    sim->hsu_send_at = 0;
+    sim->pending_len = 0;
+    sim->ack_pending = false;
+    sim->response_len = 0;
+    sim->waiting_for_tag = false;
+}
+
+void piconfc_SIM_hsuReceive(PN532Sim *sim, const uint8_t *bytes, int len) {
+    // A wake-up between frames on an idle line comes from a new client
+    uint64_t now = piconfc_HOST_now();
+    bool idle = now - sim->hsu_last_rx >= SIM_HSU_IDLE_US;
+    sim->hsu_last_rx = now;
+    if (sim->hsu_wakeup_resets && sim->hsu_awake && idle && len > 0 && bytes[0] == PN532_WAKEUP && sim->hsu_rx_len == 0) {
+        #ifdef SIM_DEBUG
+            printf("sim: wake-up on an idle line, link reset\n");
+        #endif
+        piconfc_SIM_hsuReset(sim);
+    }
+
+    for (int i = 0; i < len; i++) {
+        // Asleep, the PN532 only listens for the wake-up byte
+        if (!sim->hsu_awake) {
+            sim->hsu_awake = bytes[i] == PN532_WAKEUP;
+            continue;
+        }
+        if (sim->hsu_rx_len == SIM_MAX_FRAME) {
+            memmove(sim->hsu_rx, sim->hsu_rx + 1, --sim->hsu_rx_len); // Overrun: drop the oldest byte
+        }
+        sim->hsu_rx[sim->hsu_rx_len++] = bytes[i];
+
+        int start;
+        int framelen = piconfc_FRAME_find(sim->hsu_rx, sim->hsu_rx_len, &start);
+        if (framelen > 0) {
+            sim->stats.bus_bytes += framelen;
+            if (framelen == sizeof(SIM_ACK) - 1 && sim->hsu_rx[start + 2] == 0x00) {
+                // The host's ACK of a SetSerialBaudRate response switches the rate
+                if (sim->hsu_next_baud != 0) sim->hsu_baud = sim->hsu_next_baud;
+                sim->hsu_next_baud = 0;
+            } else {
+                // Put the preamble back in front, as the frame core expects
+                uint8_t frame[SIM_MAX_FRAME + 1] = { PN532_PREAMBLE };
+                memcpy(frame + 1, sim->hsu_rx + start, framelen);
+                sim->hsu_next_baud = 0;
+                piconfc_SIM_receive(sim, frame, framelen + 1);
+                sim->ready_at += sim_hsuWireUs(sim, framelen + 1); // The ACK counts from the last byte
+                sim->hsu_send_at = 0;
+            }
+            start += framelen;
+        }
+        memmove(sim->hsu_rx, sim->hsu_rx + start, sim->hsu_rx_len - start);
+        sim->hsu_rx_len -= start;
+    }
+}
+
+bool piconfc_SIM_hsuOpen(PN532Sim *sim, char *path, int pathsize) {
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0) return false;
+    const char *name = grantpt(fd) == 0 && unlockpt(fd) == 0 ? ptsname(fd) : NULL;
+    if (name == NULL || (int)strlen(name) >= pathsize) {
+        close(fd);
+        return false;
+    }
+    strcpy(path, name);
+
+    // Raw bytes in both directions; the terminal settings are shared with the host side
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    sim->hsu_fd = fd;
+    return true;
+}
+
+int piconfc_SIM_hsuService(PN532Sim *sim) {
+    uint8_t bytes[SIM_MAX_FRAME];
+    int due = -1;
+    ssize_t n;
+
+    pthread_mutex_lock(&sim->lock);
+    while ((n = read(sim->hsu_fd, bytes, sizeof(bytes))) > 0) piconfc_SIM_hsuReceive(sim, bytes, n);
+
+    // A ready frame goes out once it has had time to cross the wire
+    while (piconfc_SIM_ready(sim)) {
+        uint64_t now = piconfc_HOST_now();
+        if (sim->hsu_send_at == 0) sim->hsu_send_at = now + sim_hsuWireUs(sim, sim->pending_len);
+        if (now < sim->hsu_send_at) {
+            due = sim->hsu_send_at - now;
+            break;
+        }
+        int len = piconfc_SIM_transmit(sim, bytes, sizeof(bytes));
+        sim->hsu_send_at = 0;
+        sim->stats.bus_bytes += len;
+        for (int sent = 0; sent < len; ) {
+            n = write(sim->hsu_fd, bytes + sent, len - sent);
+            if (n > 0) sent += n;
+            else if (n < 0 && errno != EAGAIN && errno != EINTR) break; // Nobody on the other side
+        }
+    }
+
+    // The next frame may only become ready later
+    if (due < 0 && sim->pending_len > 0) {
+        uint64_t now = piconfc_HOST_now();
+        due = sim->ready_at > now ? sim->ready_at - now : 0;
+    }
+    pthread_mutex_unlock(&sim->lock);
+    return due;
+}
+
+static void *sim_hsuThread(void *arg) {
+    PN532Sim *sim = arg;
+    for (;;) {
+        pthread_mutex_lock(&sim->lock);
+        bool running = sim->hsu_running;
+        pthread_mutex_unlock(&sim->lock);
+        if (!running) return NULL;
+
+        // Wake for bytes from the host, the next frame falling due, or at least every millisecond
+        // so that a tag arriving on another thread is noticed
+        int due = piconfc_SIM_hsuService(sim);
+        struct pollfd pfd = { .fd = sim->hsu_fd, .events = POLLIN };
+        poll(&pfd, 1, due >= 0 && due < 1000 ? (due + 999) / 1000 : 1);
+    }
+}
+
+bool piconfc_SIM_hsuStart(PN532Sim *sim) {
+    if (sim->hsu_fd < 0) return false;
+    sim->hsu_running = true;
+    if (pthread_create(&sim->hsu_thread, NULL, sim_hsuThread, sim) != 0) {
+        sim->hsu_running = false;
+        return false;
+    }
+    return true;
+}
+
+void piconfc_SIM_hsuStop(PN532Sim *sim) {
+    pthread_mutex_lock(&sim->lock);
+    bool running = sim->hsu_running;
+    sim->hsu_running = false;
+    pthread_mutex_unlock(&sim->lock);
+    if (running) pthread_join(sim->hsu_thread, NULL);
+    if (sim->hsu_fd >= 0) close(sim->hsu_fd);
+    sim->hsu_fd = -1;
+}
@@ -0,0 +1,53 @@
+/**
+ * @file piconfc_fuzz.c
+ * @brief libFuzzer target for the NDEF parsers.
+ *
+ * The input is taken as the data area of a tag, as `piconfc_readNTAG` reads it, and goes through
+ * the same path: the NDEF TLV is found with `piconfc_NDEF_parseTLV`, its message is parsed with
+ * `piconfc_NDEF_parseMessage` and walked with the iterator, and the payload of every record is
+ * read as a string. Every read the parsers make must stay within the input.
+ *
+ * Built with clang only, when configured with -DPICONFC_FUZZ=ON:
+ *
+ *     CC=clang cmake -S . -B build-fuzz -DPICONFC_FUZZ=ON && cmake --build build-fuzz
+ *     build-fuzz/host/piconfc_fuzz -max_len=888
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "piconfc_NDEF.h"
+#include "piconfc_NTAG.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (size > NTAG_MAX_USER_BYTES) return 0;
+
+    // The parsers take a writable buffer; an exact-size copy keeps overreads visible to ASan
+    uint8_t *buffer = malloc(size > 0 ? size : 1);
+    if (buffer == NULL) return 0;
+    memcpy(buffer, data, size);
+
+    struct TLV tlv;
+    if (piconfc_NDEF_parseTLV(&tlv, buffer, size, 0)) {
+        // Every record of the message, as parsed into an array
+        NDEFRecord *records;
+        int count = piconfc_NDEF_parseMessage(tlv.value_ptr, tlv.value_length, &records);
+        for (int i = 0; i < count; i++) {
+            char *string;
+            if (piconfc_NDEF_readPayloadString(&records[i], &string)) piconfc_NDEF_free(string);
+        }
+        if (count > 0) piconfc_NDEF_free(records);
+
+        // The same records through the iterator, which must agree with parseMessage
+        NDEFIterator it;
+        NDEFRecord record;
+        int iterated = 0;
+        piconfc_NDEF_iteratorInit(&it, tlv.value_ptr, tlv.value_length);
+        while (piconfc_NDEF_iteratorNext(&it, &record)) iterated++;
+        if (count > 0 && iterated != count) abort();
+    }
+
+    free(buffer);
+    return 0;
+}
@@ -0,0 +1,403 @@
+/**
+ * @file piconfc_simd.c
+ * @brief PN532 simulator daemon: simulated readers speaking HSU to other processes.
+ *
+ * Each reader is a `PN532Sim` served on its own pseudo-terminal or UNIX socket, so any client that
+ * talks HSU to a PN532, such as `piconfc_initHSU` on a host build, runs its full stack against it as
+ * it would against hardware. All readers are served from one poll() loop on the monotonic clock, so
+ * throughput tests can run many readers and clients in parallel on one machine.
+ *
+ * Tags come and go as a script says. Each line is `TIME_MS READER ACTION [ARGS]`, with READER a
+ * reader number or `*` for all of them, and `#` starting a comment:
+ *
+ *     0     0  arrive ntag213 04A1B2C3D4E5F6 url https://example.com/badge
+ *     2500  0  depart
+ *     3000  *  arrive ntag215 auto text en Hello
+ *     4000  1  arrive ntag216 auto hex D1010855016578616D706C65
+ *
+ * A tag is `ntag213`, `ntag215` or `ntag216` with a 7-byte UID in hex, or `auto` for one made up
+ * from the reader and the event. Its NDEF message is a URI, a text record, a message in hex, or
+ * absent for a blank tag. With --loop the script starts over after its last event.
+ *
+ * Usage: piconfc_simd [--readers=N] [--socket=PREFIX] [--script=FILE] [--loop]
+ *                     [--timing=NAME=VALUE,...]
+ *
+ * Without --socket each reader gets a pseudo-terminal; with it, reader N listens on PREFIX.N and
+ * serves one client at a time. Clients of a terminal take turns too: the wake-up preamble a new
+ * client sends on the idle line returns the reader to its state after power-up. Once ready, one line per reader is printed on stdout:
+ * `reader N PATH`. Timing names are the fields of `SimTiming` (ack_us, command_us, select_us,
+ * poll_us, read_us, write_us). The statistics of each reader are printed on stderr at exit.
+ */
+
+#define _GNU_SOURCE // posix_openpt and friends, as in piconfc_SIM.c
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "piconfc_SIM.h"
+#include "piconfc_HOST.h"
+#include "piconfc_NDEF.h"
+#include "piconfc_NTAG.h"
+
+#define SIMD_MAX_READERS (64)
+#define SIMD_MAX_EVENTS (1024)
+
+typedef enum {
+    SIMD_ARRIVE,
+    SIMD_DEPART,
+} SimdAction;
+
+// One line of the script
+typedef struct {
+    uint32_t time_ms;                       // Offset from the start of the script
+    int reader;                             // Reader number, -1 for all readers
+    SimdAction action;
+    uint8_t model;                          // Model of an arriving tag
+    bool auto_uid;                          // Whether to make up the UID
+    uint8_t uid[7];                         // UID of an arriving tag
+    uint8_t image[NTAG_MAX_USER_BYTES];     // NDEF image of an arriving tag, from page 4
+    int image_len;                          // Length of image, 0 for a blank tag
+} SimdEvent;
+
+typedef struct {
+    PN532Sim sim;
+    SimTag tag;                             // The tag in the field, when there is one
+    char path[sizeof(((struct sockaddr_un *)0)->sun_path)]; // Terminal or socket path for clients
+    int listen_fd;                          // Listening socket, -1 with a pseudo-terminal
+    int slave_fd;                           // Our own handle on the terminal, so it never hangs up
+} SimdReader;
+
+static SimdReader *readers;
+static int reader_count = 1;
+static SimdEvent *events;
+static int event_count = 0;
+static volatile sig_atomic_t stopping = 0;
+
+static void simd_stop(int signum) {
+    (void)signum;
+    stopping = 1;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Script
+
+static int simd_hexdigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Decodes hex into bytes; returns the number of bytes, or -1 if the text is not hex
+static int simd_hex(const char *text, uint8_t *dest, int destsize) {
+    int len = strlen(text);
+    if (len % 2 != 0 || len / 2 > destsize) return -1;
+    for (int i = 0; i < len / 2; i++) {
+        int hi = simd_hexdigit(text[2 * i]), lo = simd_hexdigit(text[2 * i + 1]);
+        if (hi < 0 || lo < 0) return -1;
+        dest[i] = hi << 4 | lo;
+    }
+    return len / 2;
+}
+
+// Parses the tag of an arrive event: model, UID and optional content
+static bool simd_parseTag(SimdEvent *event, char *rest) {
+    char *model = strtok(rest, " \t");
+    char *uid = strtok(NULL, " \t");
+    char *kind = strtok(NULL, " \t");
+    if (model == NULL || uid == NULL) return false;
+
+    if (strcmp(model, "ntag213") == 0) event->model = MODEL_NTAG213;
+    else if (strcmp(model, "ntag215") == 0) event->model = MODEL_NTAG215;
+    else if (strcmp(model, "ntag216") == 0) event->model = MODEL_NTAG216;
+    else return false;
+
+    event->auto_uid = strcmp(uid, "auto") == 0;
+    if (!event->auto_uid && simd_hex(uid, event->uid, 7) != 7) return false;
+    if (kind == NULL) return true; // Blank tag
+
+    NDEFBuilder builder;
+    piconfc_NDEF_builderInit(&builder, event->image, sizeof(event->image));
+    if (strcmp(kind, "url") == 0) {
+        char *uri = strtok(NULL, "");
+        if (uri == NULL || !piconfc_NDEF_builderAddURI(&builder, uri)) return false;
+    } else if (strcmp(kind, "text") == 0) {
+        char *language = strtok(NULL, " \t");
+        char *text = strtok(NULL, "");
+        if (language == NULL || text == NULL || !piconfc_NDEF_builderAddText(&builder, language, text)) return false;
+    } else if (strcmp(kind, "hex") == 0) {
+        // A message in hex, wrapped in its TLV like the builder's output
+        static uint8_t message[NTAG_MAX_USER_BYTES];
+        char *hex = strtok(NULL, " \t");
+        int len = hex != NULL ? simd_hex(hex, message, sizeof(message)) : -1;
+        if (len < 0) return false;
+        int head = len < 0xFF ? 2 : 4;
+        if (head + len + 1 > (int)sizeof(event->image)) return false;
+        event->image[0] = NDEF_TLV_NDEF;
+        if (head == 2) {
+            event->image[1] = len;
+        } else {
+            event->image[1] = 0xFF;
+            event->image[2] = len >> 8;
+            event->image[3] = len;
+        }
+        memcpy(event->image + head, message, len);
+        event->image[head + len] = NDEF_TLV_TERMINATOR;
+        event->image_len = head + len + 1;
+        return true;
+    } else {
+        return false;
+    }
+    event->image_len = piconfc_NDEF_builderFinish(&builder);
+    return event->image_len > 0;
+}
+
+static bool simd_loadScript(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        perror(path);
+        return false;
+    }
+
+    char line[1024];
+    int number = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        number++;
+        line[strcspn(line, "#\r\n")] = '\0';
+        char *time = strtok(line, " \t");
+        if (time == NULL) continue; // Blank or comment
+
+        char *reader = strtok(NULL, " \t");
+        char *action = strtok(NULL, " \t");
+        char *rest = strtok(NULL, "");
+        if (event_count == SIMD_MAX_EVENTS || reader == NULL || action == NULL) goto invalid;
+
+        SimdEvent *event = &events[event_count];
+        memset(event, 0, sizeof(*event));
+        event->time_ms = strtoul(time, NULL, 10);
+        event->reader = strcmp(reader, "*") == 0 ? -1 : atoi(reader);
+        if (event->reader >= reader_count) goto invalid;
+        if (event_count > 0 && event->time_ms < events[event_count - 1].time_ms) goto invalid; // In order
+
+        if (strcmp(action, "arrive") == 0) {
+            event->action = SIMD_ARRIVE;
+            if (rest == NULL || !simd_parseTag(event, rest)) goto invalid;
+        } else if (strcmp(action, "depart") == 0) {
+            event->action = SIMD_DEPART;
+        } else {
+            goto invalid;
+        }
+        event_count++;
+    }
+    fclose(file);
+    return true;
+
+invalid:
+    fprintf(stderr, "%s:%d: invalid event\n", path, number);
+    fclose(file);
+    return false;
+}
+
+static void simd_apply(const SimdEvent *event, uint32_t serial) {
+    for (int i = 0; i < reader_count; i++) {
+        if (event->reader >= 0 && event->reader != i) continue;
+        SimdReader *reader = &readers[i];
+
+        if (event->action == SIMD_DEPART) {
+            piconfc_SIM_setTag(&reader->sim, NULL);
+            continue;
+        }
+
+        // A made-up UID is unique per reader and event, so each arrival reads as a new tag
+        uint8_t uid[7] = { 0x04, 0x51, 0x4D, i, serial >> 16, serial >> 8, serial };
+        piconfc_SIM_setTag(&reader->sim, NULL); // Whatever was there leaves first
+        piconfc_SIM_formatTag(&reader->tag, event->model, event->auto_uid ? uid : event->uid);
+        memcpy(reader->tag.memory + NTAG_USER_START_PAGE * NTAG_PAGE_SIZE, event->image, event->image_len);
+        piconfc_SIM_setTag(&reader->sim, &reader->tag);
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// Readers
+
+static bool simd_parseTiming(SimTiming *timing, char *list) {
+    for (char *item = strtok(list, ","); item != NULL; item = strtok(NULL, ",")) {
+        char *value = strchr(item, '=');
+        if (value == NULL) return false;
+        *value++ = '\0';
+        uint32_t us = strtoul(value, NULL, 10);
+        if (strcmp(item, "ack_us") == 0) timing->ack_us = us;
+        else if (strcmp(item, "command_us") == 0) timing->command_us = us;
+        else if (strcmp(item, "select_us") == 0) timing->select_us = us;
+        else if (strcmp(item, "poll_us") == 0) timing->poll_us = us;
+        else if (strcmp(item, "read_us") == 0) timing->read_us = us;
+        else if (strcmp(item, "write_us") == 0) timing->write_us = us;
+        else return false;
+    }
+    return true;
+}
+
+static bool simd_openReader(SimdReader *reader, int number, const char *socket_prefix) {
+    reader->listen_fd = -1;
+    reader->slave_fd = -1;
+
+    if (socket_prefix == NULL) {
+        if (!piconfc_SIM_hsuOpen(&reader->sim, reader->path, sizeof(reader->path))) return false;
+        // Holding the terminal open ourselves keeps the master from reporting a hang-up between clients,
+        // so a new client is told apart by the wake-up it sends on the idle line
+        reader->sim.hsu_wakeup_resets = true;
+        reader->slave_fd = open(reader->path, O_RDWR | O_NOCTTY);
+        return reader->slave_fd >= 0;
+    }
+
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (snprintf(addr.sun_path, sizeof(addr.sun_path), "%s.%d", socket_prefix, number) >= (int)sizeof(addr.sun_path)) return false;
+    strcpy(reader->path, addr.sun_path);
+    unlink(addr.sun_path);
+
+    reader->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    return reader->listen_fd >= 0 && bind(reader->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == 0 &&
+           listen(reader->listen_fd, 1) == 0;
+}
+
+static void simd_closeReader(SimdReader *reader) {
+    if (reader->listen_fd >= 0) {
+        if (reader->sim.hsu_fd >= 0) close(reader->sim.hsu_fd);
+        reader->sim.hsu_fd = -1;
+        close(reader->listen_fd);
+        unlink(reader->path);
+    } else {
+        piconfc_SIM_hsuStop(&reader->sim);
+        if (reader->slave_fd >= 0) close(reader->slave_fd);
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+
+int main(int argc, char **argv) {
+    const char *socket_prefix = NULL;
+    const char *script = NULL;
+    char *timing = NULL;
+    bool loop = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--readers=", 10) == 0) {
+            reader_count = atoi(argv[i] + 10);
+        } else if (strncmp(argv[i], "--socket=", 9) == 0) {
+            socket_prefix = argv[i] + 9;
+        } else if (strncmp(argv[i], "--script=", 9) == 0) {
+            script = argv[i] + 9;
+        } else if (strcmp(argv[i], "--loop") == 0) {
+            loop = true;
+        } else if (strncmp(argv[i], "--timing=", 9) == 0) {
+            timing = argv[i] + 9;
+        } else {
+            reader_count = 0; // Show the usage
+            break;
+        }
+    }
+    if (reader_count < 1 || reader_count > SIMD_MAX_READERS) {
+        fprintf(stderr, "usage: %s [--readers=1..%d] [--socket=PREFIX] [--script=FILE] [--loop] [--timing=NAME=VALUE,...]\n",
+                argv[0], SIMD_MAX_READERS);
+        return 1;
+    }
+
+    readers = calloc(reader_count, sizeof(SimdReader));
+    events = calloc(SIMD_MAX_EVENTS, sizeof(SimdEvent));
+    if (readers == NULL || events == NULL) return 1;
+    if (script != NULL && !simd_loadScript(script)) return 1;
+
+    // Every reader runs on the same monotonic clock, with the same timing
+    piconfc_HOST_useVirtualClock(false);
+    for (int i = 0; i < reader_count; i++) {
+        piconfc_SIM_init(&readers[i].sim);
+        if (timing != NULL) {
+            char list[256];
+            snprintf(list, sizeof(list), "%s", timing);
+            if (!simd_parseTiming(&readers[i].sim.timing, list)) {
+                fprintf(stderr, "invalid timing: %s\n", timing);
+                return 1;
+            }
+        }
+        if (!simd_openReader(&readers[i], i, socket_prefix)) {
+            perror("reader");
+            return 1;
+        }
+        printf("reader %d %s\n", i, readers[i].path);
+    }
+    fflush(stdout);
+
+    signal(SIGINT, simd_stop);
+    signal(SIGTERM, simd_stop);
+    signal(SIGPIPE, SIG_IGN); // A client going away shows up as a failed write
+
+    uint64_t script_start = piconfc_HOST_now();
+    uint32_t serial = 0;
+    int next = 0;
+    struct pollfd pfds[SIMD_MAX_READERS];
+
+    while (!stopping) {
+        // Events that have fallen due
+        uint64_t now = piconfc_HOST_now();
+        while (next < event_count && now >= script_start + events[next].time_ms * 1000ull) {
+            simd_apply(&events[next++], serial++);
+        }
+        if (loop && next == event_count && event_count > 0) {
+            script_start += events[event_count - 1].time_ms * 1000ull + 1000; // The last event lasts a second
+            next = 0;
+        }
+
+        // Serve every connected reader and find out when the next frame or event falls due
+        int timeout = -1;
+        if (next < event_count) {
+            int64_t until = (int64_t)(script_start + events[next].time_ms * 1000ull) - (int64_t)now;
+            timeout = until > 0 ? (int)((until + 999) / 1000) : 0;
+        }
+        for (int i = 0; i < reader_count; i++) {
+            SimdReader *reader = &readers[i];
+            pfds[i].fd = reader->sim.hsu_fd >= 0 ? reader->sim.hsu_fd : reader->listen_fd;
+            pfds[i].events = POLLIN;
+            if (reader->sim.hsu_fd < 0) continue;
+
+            int due = piconfc_SIM_hsuService(&reader->sim);
+            if (due >= 0 && (timeout < 0 || (due + 999) / 1000 < timeout)) timeout = (due + 999) / 1000;
+        }
+
+        if (poll(pfds, reader_count, timeout) < 0 && errno != EINTR) break;
+
+        // Accept a client on an idle socket, and drop clients that have gone away
+        for (int i = 0; i < reader_count; i++) {
+            SimdReader *reader = &readers[i];
+            if (reader->listen_fd < 0) continue;
+            if (reader->sim.hsu_fd < 0 && (pfds[i].revents & POLLIN)) {
+                int fd = accept(reader->listen_fd, NULL, NULL);
+                if (fd < 0) continue;
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                piconfc_SIM_hsuReset(&reader->sim); // A new client starts from a PN532 as after power-up
+                reader->sim.hsu_fd = fd;
+            } else if (reader->sim.hsu_fd >= 0 && (pfds[i].revents & (POLLHUP | POLLERR))) {
+                piconfc_SIM_hsuService(&reader->sim); // Take what was sent before the hang-up
+                close(reader->sim.hsu_fd);
+                reader->sim.hsu_fd = -1;
+            }
+        }
+    }
+
+    for (int i = 0; i < reader_count; i++) {
+        SimStats *stats = &readers[i].sim.stats;
+        fprintf(stderr, "reader %d: %u frames, %u selects, %u reads, %u writes, %u bytes\n", i, (unsigned)stats->frames,
+                (unsigned)stats->selects, (unsigned)stats->reads, (unsigned)stats->writes, (unsigned)stats->bus_bytes);
+        simd_closeReader(&readers[i]);
+    }
+    free(readers);
+    free(events);
+    return 0;
+}
@@ -0,0 +1,97 @@
+/**
+ * @file piconfc_simd_client.c
+ * @brief Example HSU client: reads the tag on a reader of `piconfc_simd` over and over.
+ *
+ * The client runs the full stack a Pico would: `piconfc_initHSU` wakes the PN532 and moves the link
+ * to the given rate, and every read is a `piconfc_readNTAGString`. The reader is a terminal path as
+ * printed by the daemon, or `unix:PATH` for a reader served on a socket with --socket.
+ *
+ * Several clients in parallel, one per reader, measure the throughput of the daemon:
+ *
+ *     piconfc_simd --readers=4 --script=badges.txt > readers.txt & sleep 1
+ *     for path in $(cut -d' ' -f3 readers.txt); do piconfc_simd_client $path --reads=100 & done; wait
+ *
+ * with badges.txt holding `0 * arrive ntag213 auto url https://example.com/badge`.
+ *
+ * Usage: piconfc_simd_client DEVICE [--reads=N] [--baud=RATE]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "piconfc.h"
+#include "piconfc_HOST.h"
+#include "hardware/uart.h"
+
+// Connects to a reader served on a UNIX socket; the UART stand-in takes any file descriptor
+static bool client_connect(uart_inst_t *uart, const char *path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(addr.sun_path)) return false;
+    strcpy(addr.sun_path, path);
+
+    uart->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    uart->baudrate = 0;
+    if (uart->fd < 0) return false;
+    if (connect(uart->fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(uart->fd);
+        uart->fd = -1;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    const char *device = NULL;
+    int reads = 10;
+    uint32_t baudrate = PICONFC_HSU_MAX_BAUD;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--reads=", 8) == 0) {
+            reads = atoi(argv[i] + 8);
+        } else if (strncmp(argv[i], "--baud=", 7) == 0) {
+            baudrate = strtoul(argv[i] + 7, NULL, 10);
+        } else if (device == NULL && argv[i][0] != '-') {
+            device = argv[i];
+        } else {
+            device = NULL;
+            break;
+        }
+    }
+    if (device == NULL) {
+        fprintf(stderr, "usage: %s DEVICE [--reads=N] [--baud=RATE]\n", argv[0]);
+        return 1;
+    }
+
+    static uart_inst_t uart;
+    bool opened = strncmp(device, "unix:", 5) == 0 ? client_connect(&uart, device + 5) : piconfc_HOST_uartOpen(&uart, device);
+    if (!opened) {
+        perror(device);
+        return 1;
+    }
+
+    static PicoNFCConfig config;
+    if (!piconfc_initHSU(&config, &uart, 0, 1, baudrate)) {
+        fprintf(stderr, "%s: no PN532 answered\n", device);
+        return 1;
+    }
+
+    // Read the tag in the field, keeping the first string to show what was read
+    char first[128] = "";
+    int ok = 0;
+    uint64_t start = piconfc_HOST_now();
+    for (int i = 0; i < reads; i++) {
+        char string[128];
+        int len = piconfc_readNTAGString(&config, 1000, string, sizeof(string));
+        if (len < 0) continue;
+        if (ok++ == 0) snprintf(first, sizeof(first), "%s", string);
+    }
+    uint64_t elapsed_us = piconfc_HOST_now() - start;
+
+    printf("%s: %d/%d reads in %llu ms: %s\n", device, ok, reads, (unsigned long long)(elapsed_us / 1000), first);
+    close(uart.fd);
+    return ok == reads ? 0 : 2;
+}
@@ -1,3 +1,6 @@
+#include "piconfc_I2C.h"
+#include "piconfc_SPI.h"
+#include "piconfc_HSU.h"
 #include "piconfc_PN532.h"
 #include "piconfc_NDEF.h"
 #include "piconfc_NTAG.h"
@@ -5,9 +8,15 @@
 #ifndef PICONFC_H
 #define PICONFC_H
 
+#define PICONFC_MAX_RECORDS (16) ///< Records parsed into a PicoNFCTag; iterate `message` for more
+
 typedef struct {
-    i2c_inst_t *i2c_block;
+    i2c_inst_t *i2c_block;       // I2C block set by piconfc_init, NULL with piconfc_initTransport
+    PicoNFCSPIBus spi_bus;       // SPI bus set by piconfc_initSPI
+    PicoNFCHSUBus hsu_bus;       // UART set by piconfc_initHSU
+    PicoNFCTransport transport;  // Host interface the PN532 is reached through
     uint8_t scratch[1024];
+    bool verify_writes; // Read back and retry NTAG page writes, see piconfc_NTAG_writePages
 } PicoNFCConfig;
 
 /**
@@ -16,6 +25,7 @@ typedef struct {
  * This function initializes the Pico NFC configuration by setting the I2C block,
  * configuring the specified SDA and SCL pins for I2C communication, and performing
  * the necessary SAM (Secure Access Module) configuration for the NFC module.
+ * Write verification starts disabled; set `verify_writes` afterwards to enable it.
  *
  * @param empty_config Pointer to an empty PicoNFCConfig structure to be initialized.
  * @param i2c_block Pointer to the I2C instance (e.g., `i2c0` or `i2c1`).
@@ -25,6 +35,102 @@ typedef struct {
  */
 bool piconfc_init(PicoNFCConfig *empty_config, i2c_inst_t *i2c_block, int sda_pin, int scl_pin);
 
+/**
+ * @brief Initializes the Pico NFC configuration with a PN532 on a Pico SPI block.
+ *
+ * This is `piconfc_init` for a PN532 strapped for SPI, which moves frames at up to 5 MHz instead
+ * of 400 kHz. The bus is kept in the configuration; see `piconfc_SPI_init` for the pin setup.
+ *
+ * @param empty_config Pointer to an empty PicoNFCConfig structure to be initialized.
+ * @param spi_block Pointer to the SPI instance (e.g., `spi0` or `spi1`).
+ * @param sck_pin GPIO pin number for the SPI SCK line.
+ * @param mosi_pin GPIO pin number for the SPI MOSI line.
+ * @param miso_pin GPIO pin number for the SPI MISO line.
+ * @param cs_pin GPIO pin number for the PN532 chip select.
+ * @return True if the SAM configuration was successful; false otherwise.
+ */
+bool piconfc_initSPI(PicoNFCConfig *empty_config, spi_inst_t *spi_block, int sck_pin, int mosi_pin, int miso_pin, int cs_pin);
+
+/**
+ * @brief Initializes the Pico NFC configuration with a PN532 on a Pico UART (HSU).
+ *
+ * The PN532 is woken up at 115200 baud and configured, and if a different rate is asked for, both
+ * sides are then switched to it with SetSerialBaudRate. The UART is kept in the configuration.
+ *
+ * @param empty_config Pointer to an empty PicoNFCConfig structure to be initialized.
+ * @param uart_block Pointer to the UART instance (e.g., `uart0` or `uart1`).
+ * @param tx_pin GPIO pin number for the UART TX line.
+ * @param rx_pin GPIO pin number for the UART RX line.
+ * @param baudrate Rate to run at, up to `PICONFC_HSU_MAX_BAUD` (see `piconfc_PN532_setSerialBaudRate`).
+ * @return True if the SAM configuration and any rate change were successful; false otherwise.
+ */
+bool piconfc_initHSU(PicoNFCConfig *empty_config, uart_inst_t *uart_block, int tx_pin, int rx_pin, uint32_t baudrate);
+
+/**
+ * @brief Initializes the Pico NFC configuration with a PN532 on any transport.
+ *
+ * This is `piconfc_init` for backends other than a Pico I2C block, such as the Linux i2c-dev backend
+ * or a simulated PN532. The transport is copied into the configuration and must already be set up;
+ * the state its `ctx` points to must outlive the configuration.
+ *
+ * @param empty_config Pointer to an empty PicoNFCConfig structure to be initialized.
+ * @param transport Pointer to the transport to reach the PN532 through.
+ * @return True if the SAM configuration was successful; false otherwise.
+ */
+bool piconfc_initTransport(PicoNFCConfig *empty_config, const PicoNFCTransport *transport);
+
+/**
+ * @brief Everything read from a tag in one pass by `piconfc_readTag`.
+ *
+ * The records are views into the caller's buffer, which must outlive this structure.
+ */
+typedef struct {
+    uint8_t uid[7];                              // UID of the tag
+    uint8_t uid_len;                             // Length of the UID
+    uint8_t cc[4];                               // Capability container (page 3)
+    uint8_t model;                               // Model from the capability container, see enum NTAG21X
+    uint8_t *data;                               // Caller buffer holding the data area from page 4
+    int data_len;                                // Bytes of the data area read into data
+    int reads;                                   // READ commands issued
+    NDEFSlice message;                           // The NDEF message, or the part of it that was read
+    NDEFRecord records[PICONFC_MAX_RECORDS];     // The first records of the message
+    int record_count;                            // Number of entries in records
+    bool complete;                               // Whether the whole NDEF message was read
+} PicoNFCTag;
+
+/**
+ * @brief Options for `piconfc_readTag` to stop reading early.
+ *
+ * Reading stops as soon as a complete record with the given TNF and type has been read, so
+ * later pages are never read. With `type` NULL, the first record of any type stops the read.
+ */
+typedef struct {
+    enum TNF tnf;           // TNF of the record to stop at
+    const uint8_t *type;    // Type of the record to stop at, or NULL for any record
+    uint8_t type_length;    // Length of type
+} PicoNFCReadOptions;
+
+/**
+ * @brief Reads the tag information and all NDEF records from a tag in one pass.
+ *
+ * The capability container and the data area are read with READ commands starting at page 3, so
+ * the model comes with the first 12 data bytes instead of a separate read. After each READ the TLVs
+ * read so far are walked, and reading stops once the NDEF message is complete, once a Terminator TLV
+ * shows there is none, or once the record requested in `options` has been read. Only the pages
+ * that hold the message are read, not the whole user memory.
+ *
+ * @param config Pointer to the PicoNFCConfig structure containing the NFC configuration.
+ * @param timeout_ms Timeout in milliseconds to wait for the tag.
+ * @param buffer Pointer to the caller buffer receiving the data area. 888 bytes hold any NTAG21X.
+ * @param bufsize Size of the buffer in bytes.
+ * @param options Pointer to options for stopping early, or NULL to read the whole message.
+ * @param tag Pointer to a `PicoNFCTag` to fill. Records past `PICONFC_MAX_RECORDS` can be read by
+ *            iterating `tag->message` with an `NDEFIterator`.
+ * @return True if a tag was found and its capability container read; false otherwise. A tag without
+ *         an NDEF message is returned with `record_count` 0.
+ */
+bool piconfc_readTag(PicoNFCConfig *config, int timeout_ms, uint8_t *buffer, int bufsize, const PicoNFCReadOptions *options, PicoNFCTag *tag);
+
 // static bool last = false;
 /**
  * @brief Reads an NTAG and retrieves its payload as a string.
@@ -32,16 +138,36 @@ bool piconfc_init(PicoNFCConfig *empty_config, i2c_inst_t *i2c_block, int sda_pi
  * This function reads data from an NTAG NFC tag, parses the NDEF message, and retrieves the
  * payload from the first NDEF record as a dynamically allocated string. The caller is 
  * responsible for freeing the allocated string once it is no longer needed.
+ * The string is the only allocation made, through the NDEF allocator hooks. With an `NDEFArena`
+ * installed by `piconfc_NDEF_setAllocator`, the arena can simply be reset with
+ * `piconfc_NDEF_arenaReset` once the string has been consumed.
  *
  * @param config Pointer to the PicoNFCConfig structure containing the NFC configuration.
  * @param timeout_ms Timeout in milliseconds to wait for the tag.
  * @param string_ptr Pointer to a char pointer where the resulting string will be stored.
- *                   The caller is responsible for freeing this string if the function succeeds.
+ *                   The caller is responsible for freeing this string with `piconfc_NDEF_free`
+ *                   if the function succeeds.
  * @return True if a valid NDEF message was read and the payload was successfully retrieved;
  *         false otherwise.
  */
 bool piconfc_readNTAG(PicoNFCConfig *config, int timeout_ms, char **string_ptr);
 
+/**
+ * @brief Reads an NTAG and copies its payload string into a caller buffer.
+ *
+ * This is the allocation-free form of `piconfc_readNTAG`. The payload of the first NDEF record is
+ * copied with `piconfc_NDEF_copyPayloadString`, so the result is truncated to `destsize - 1` bytes,
+ * always null-terminated, and the full length is returned to detect truncation.
+ *
+ * @param config Pointer to the PicoNFCConfig structure containing the NFC configuration.
+ * @param timeout_ms Timeout in milliseconds to wait for the tag.
+ * @param dest Pointer to the destination buffer.
+ * @param destsize Size of the destination buffer in bytes.
+ * @return The length of the full payload string, excluding the null terminator; -1 if no tag
+ *         was found or it holds no valid NDEF message.
+ */
+int piconfc_readNTAGString(PicoNFCConfig *config, int timeout_ms, char *dest, int destsize);
+
 /**
  * @brief Checks if an NFC tag is present within the read range.
  *
@@ -55,7 +181,149 @@ bool piconfc_readNTAG(PicoNFCConfig *config, int timeout_ms, char **string_ptr);
  */
 bool piconfc_tagPresent(PicoNFCConfig *config, int delay_ms);
 
-// NFC tag read url
-// NFC tag write url
+/**
+ * @brief State for bulk provisioning of blank tags with one (templated) NDEF message.
+ *
+ * The message is encoded once into `image`, laid out exactly as it is written to the tag
+ * starting at page 4 and padded to a whole number of pages. Per-tag fields such as serial
+ * numbers are patched into the image in place between tags, so no record is re-encoded and
+ * nothing is allocated per tag.
+ */
+typedef struct {
+    uint8_t image[NTAG_MAX_USER_BYTES]; // Page-aligned TLV image written from page 4
+    int image_len;                      // Length of the image in bytes, a multiple of NTAG_PAGE_SIZE
+    int payload_offset;                 // Offset of the record payload within the image
+    int payload_length;                 // Length of the record payload
+    bool check_model;                   // Whether the image is too big to skip the model read
+    uint8_t last_uid[7];                // UID of the last provisioned tag
+    uint8_t last_uid_len;               // Length of last_uid, 0 if no tag has been provisioned
+    uint32_t tags_written;              // Tags written and verified since the job was prepared
+    uint32_t tags_failed;               // Tags that failed to write or verify
+    uint32_t start_ms;                  // Time the job was prepared, in ms since boot
+} PicoNFCProvisionJob;
+
+/**
+ * @brief Prepares a provisioning job by encoding a single-record NDEF message once.
+ *
+ * The record is encoded a single time with an `NDEFBuilder` directly into `job->image`, which
+ * holds the finished, page-aligned TLV image without any allocation. The job's
+ * counters and throughput timer are reset. The payload passed here acts as the template; fields
+ * that change per tag can later be overwritten with `piconfc_provisionSetField`.
+ *
+ * @param job Pointer to the job to prepare.
+ * @param tnf Type Name Format of the record.
+ * @param type Pointer to the record type.
+ * @param typelen Length of the record type in bytes.
+ * @param payload Pointer to the template payload.
+ * @param payloadlen Length of the template payload in bytes.
+ * @return True if the message was encoded and fits in an NTAG216; false otherwise.
+ */
+bool piconfc_provisionPrepare(PicoNFCProvisionJob *job, enum TNF tnf, uint8_t *type, uint8_t typelen, uint8_t *payload, unsigned int payloadlen);
+
+/**
+ * @brief Patches a templated field of the prepared payload in place.
+ *
+ * This copies `len` bytes into the encoded image at `offset` bytes into the record payload.
+ * Lengths in the record and TLV headers are not changed, so the field must keep a fixed size.
+ *
+ * @param job Pointer to a prepared job.
+ * @param offset Offset of the field within the record payload.
+ * @param data Pointer to the new field contents.
+ * @param len Length of the field in bytes.
+ * @return True if the field was patched; false if it does not fit within the payload.
+ */
+bool piconfc_provisionSetField(PicoNFCProvisionJob *job, int offset, const uint8_t *data, int len);
+
+/**
+ * @brief Waits for the next blank tag, writes the prepared image to it and verifies it.
+ *
+ * A tag whose UID matches the last provisioned tag is ignored, so a tag left in the field is
+ * not written twice. Only the pages covered by the image are written. The tag model is only read
+ * when the image is larger than the user memory of an NTAG213, the smallest supported tag.
+ * The pages are always written with verification enabled, regardless of `config->verify_writes`.
+ * A tag that does not already hold an empty NDEF TLV at page 4 is first given one, and the page
+ * holding the TLV length is written last, so a tag pulled early does not advertise a half-written
+ * message.
+ *
+ * @param config Pointer to the PicoNFCConfig structure containing the NFC configuration.
+ * @param job Pointer to a prepared job.
+ * @param timeout_ms Timeout in milliseconds to wait for a tag.
+ * @return True if a new tag was written and verified; false if no new tag was found or the
+ *         write failed. Failed writes are counted in `job->tags_failed`.
+ */
+bool piconfc_provisionNext(PicoNFCConfig *config, PicoNFCProvisionJob *job, int timeout_ms);
+
+/**
+ * @brief Returns the provisioning throughput of a job in tags per minute.
+ *
+ * @param job Pointer to a prepared job.
+ * @return Verified tags per minute since the job was prepared, or 0 if no time has elapsed.
+ */
+float piconfc_provisionRate(PicoNFCProvisionJob *job);
+
+/**
+ * @brief Writes a finished TLV image to the tag in the field with as few page writes as possible.
+ *
+ * The image is compared with the tag's current contents by `piconfc_NTAG_recoverNDEF`, so only the
+ * pages that differ are written, using the tear-safe NDEF update sequence. Rewriting the same message
+ * costs only the READs. The tag model is only read when the image is larger than the user memory of
+ * an NTAG213. Pages are verified when `config->verify_writes` is set.
+ *
+ * @param config Pointer to the PicoNFCConfig structure containing the NFC configuration.
+ * @param timeout_ms Timeout in milliseconds to wait for the tag.
+ * @param image Pointer to the page-aligned TLV image, such as the output of `piconfc_NDEF_builderFinish`.
+ * @param len Length of the image in bytes. Must be a multiple of `NTAG_PAGE_SIZE`.
+ * @return The number of page writes issued (0 if the tag already held the message), or -1 if no tag
+ *         was found, the image does not fit the tag, or a read or write failed.
+ */
+int piconfc_writeMessage(PicoNFCConfig *config, int timeout_ms, uint8_t *image, int len);
+
+/**
+ * @brief Writes a single URI record to the tag in the field.
+ *
+ * The record is built with `piconfc_NDEF_builderAddURI`, so the longest matching URI prefix is
+ * abbreviated, and written with `piconfc_writeMessage`.
+ *
+ * @param config Pointer to the PicoNFCConfig structure containing the NFC configuration.
+ * @param timeout_ms Timeout in milliseconds to wait for the tag.
+ * @param uri Null-terminated URI, such as "https://example.com".
+ * @return The number of page writes issued, or -1 on failure. See `piconfc_writeMessage`.
+ */
+int piconfc_writeURI(PicoNFCConfig *config, int timeout_ms, const char *uri);
+
+/**
+ * @brief Writes a single UTF-8 Text record to the tag in the field.
+ *
+ * @param config Pointer to the PicoNFCConfig structure containing the NFC configuration.
+ * @param timeout_ms Timeout in milliseconds to wait for the tag.
+ * @param language Null-terminated IANA language code, such as "en".
+ * @param text Null-terminated UTF-8 text.
+ * @return The number of page writes issued, or -1 on failure. See `piconfc_writeMessage`.
+ */
+int piconfc_writeText(PicoNFCConfig *config, int timeout_ms, const char *language, const char *text);
+
+/**
+ * @brief Writes a single MIME media record to the tag in the field.
+ *
+ * @param config Pointer to the PicoNFCConfig structure containing the NFC configuration.
+ * @param timeout_ms Timeout in milliseconds to wait for the tag.
+ * @param mime Null-terminated MIME type, such as "text/plain".
+ * @param data Pointer to the payload.
+ * @param len Length of the payload in bytes.
+ * @return The number of page writes issued, or -1 on failure. See `piconfc_writeMessage`.
+ */
+int piconfc_writeMIME(PicoNFCConfig *config, int timeout_ms, const char *mime, const uint8_t *data, int len);
+
+/**
+ * @brief Writes a single NFC Forum external type record to the tag in the field.
+ *
+ * @param config Pointer to the PicoNFCConfig structure containing the NFC configuration.
+ * @param timeout_ms Timeout in milliseconds to wait for the tag.
+ * @param type Null-terminated external type, such as "example.com:badge".
+ * @param data Pointer to the payload.
+ * @param len Length of the payload in bytes.
+ * @return The number of page writes issued, or -1 on failure. See `piconfc_writeMessage`.
+ */
+int piconfc_writeExternal(PicoNFCConfig *config, int timeout_ms, const char *type, const uint8_t *data, int len);
 
 #endif /* PICONFC_H */
\ No newline at end of file
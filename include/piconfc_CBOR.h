@@ -0,0 +1,270 @@
+/**
+ * @file piconfc_CBOR.h
+ * @brief A zero-allocation CBOR (RFC 8949) reader and writer for compact structured NDEF payloads.
+ *
+ * Structured data such as badge or configuration records is smaller as CBOR than as JSON and
+ * needs no text parsing on the MCU. CBOR payloads are carried in external-type records
+ * (`CBOR_EXTERNAL_TYPE`). The reader walks a payload item by item and returns strings as views
+ * into the tag buffer; the writer encodes straight into a caller buffer, or into the tag image
+ * through `piconfc_CBOR_builderOpen`. Neither allocates.
+ *
+ * Indefinite-length arrays and maps are supported; indefinite-length strings are not, since
+ * their chunks cannot be returned as a single view.
+ */
+
+#ifndef PICONFC_CBOR_H
+#define PICONFC_CBOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "piconfc_NDEF.h"
+
+/**
+ * @brief Type of the external (TNF_EXTERNAL) records carrying CBOR payloads.
+ */
+#define CBOR_EXTERNAL_TYPE "piconfc:cbor"
+
+#define CBOR_INDEFINITE (0xFFFFFFFFu) ///< Item count of an indefinite-length array or map
+#define CBOR_MAX_DEPTH (8)            ///< Deepest nesting piconfc_CBOR_skip can skip over
+
+/**
+ * @enum CBORType
+ * @brief The kinds of item returned by `piconfc_CBOR_next`.
+ */
+enum CBORType {
+    CBOR_TYPE_UINT,      ///< Unsigned integer, in `uint`
+    CBOR_TYPE_NEGINT,    ///< Negative integer, in `sint`
+    CBOR_TYPE_BYTES,     ///< Byte string, in `string`
+    CBOR_TYPE_TEXT,      ///< UTF-8 text string, in `string` (not null-terminated)
+    CBOR_TYPE_ARRAY,     ///< Array header, item count in `count`; the items follow
+    CBOR_TYPE_MAP,       ///< Map header, pair count in `count`; the keys and values follow
+    CBOR_TYPE_TAG,       ///< Tag number in `uint`; the tagged item follows
+    CBOR_TYPE_BOOL,      ///< true or false, in `boolean`
+    CBOR_TYPE_NULL,      ///< null
+    CBOR_TYPE_UNDEFINED, ///< undefined
+    CBOR_TYPE_FLOAT,     ///< Half, single or double precision float, in `number`
+    CBOR_TYPE_SIMPLE,    ///< Other simple value, in `uint`
+    CBOR_TYPE_BREAK      ///< End of an indefinite-length array or map
+};
+
+/**
+ * @brief A single CBOR item. Strings point into the buffer being read.
+ */
+typedef struct {
+    enum CBORType type;
+    union {
+        uint64_t uint;
+        int64_t sint;
+        NDEFSlice string;
+        uint32_t count;
+        bool boolean;
+        double number;
+    };
+} CBORValue;
+
+/**
+ * @brief Position of a reader in a CBOR payload.
+ */
+typedef struct {
+    const uint8_t * buffer;
+    int len;
+    int offset; ///< Offset of the next item header
+    bool error; ///< Set on malformed or unsupported input; the reader then returns no more items
+} CBORReader;
+
+/**
+ * @brief Encoder writing CBOR into a caller buffer.
+ */
+typedef struct {
+    uint8_t * buffer;
+    int bufsize;
+    int head;    ///< Bytes written so far
+    bool failed; ///< Set when an item did not fit; later writes are ignored
+} CBORWriter;
+
+/**
+ * @brief Prepares a reader over a CBOR payload.
+ *
+ * @param reader Pointer to the reader to initialize.
+ * @param buffer Pointer to the payload.
+ * @param len Length of the payload in bytes.
+ */
+void piconfc_CBOR_readerInit(CBORReader *reader, const uint8_t *buffer, int len);
+
+/**
+ * @brief Prepares a reader over the payload of a CBOR record.
+ *
+ * @param reader Pointer to the reader to initialize.
+ * @param record Pointer to a parsed record.
+ * @return True if the record is of external type `CBOR_EXTERNAL_TYPE`; false otherwise.
+ */
+bool piconfc_CBOR_readerInitRecord(CBORReader *reader, const NDEFRecord *record);
+
+/**
+ * @brief Reads the next item header.
+ *
+ * Scalars and strings are read whole. For arrays, maps and tags only the header is read and the
+ * reader is left at their first contained item, so nested data is read by calling this again.
+ *
+ * @param reader Pointer to an initialized reader.
+ * @param value Pointer to a `CBORValue` to populate.
+ * @return True if an item was read; false at the end of the payload or on malformed input
+ *         (see `reader->error`).
+ */
+bool piconfc_CBOR_next(CBORReader *reader, CBORValue *value);
+
+/**
+ * @brief Skips the next complete item, including everything nested in it.
+ *
+ * @param reader Pointer to an initialized reader.
+ * @return True if an item was skipped; false at the end of the payload, on malformed input, or if
+ *         the item is nested deeper than `CBOR_MAX_DEPTH`.
+ */
+bool piconfc_CBOR_skip(CBORReader *reader);
+
+/**
+ * @brief Finds the value of a text key in a map.
+ *
+ * The reader must be positioned at the first key, i.e. just after the map header returned by
+ * `piconfc_CBOR_next`. Pairs are scanned in order and non-matching values are skipped without
+ * being decoded. On success the reader is left after the value's header, as with `piconfc_CBOR_next`.
+ *
+ * @param reader Pointer to a reader positioned at the first key of a map.
+ * @param count Pair count of the map, as returned in the map header (may be `CBOR_INDEFINITE`).
+ * @param key Null-terminated key to find.
+ * @param value Pointer to a `CBORValue` to populate with the value.
+ * @return True if the key was found; false otherwise.
+ */
+bool piconfc_CBOR_mapFind(CBORReader *reader, uint32_t count, const char *key, CBORValue *value);
+
+/**
+ * @brief Prepares a writer over a caller buffer.
+ *
+ * @param writer Pointer to the writer to initialize.
+ * @param buffer Pointer to the destination buffer.
+ * @param bufsize Size of the destination buffer in bytes.
+ */
+void piconfc_CBOR_writerInit(CBORWriter *writer, uint8_t *buffer, int bufsize);
+
+/**
+ * @brief Writes an unsigned integer in its shortest form.
+ *
+ * @param writer Pointer to an initialized writer.
+ * @param value The value to write.
+ * @return True if the item was written; false if it does not fit.
+ */
+bool piconfc_CBOR_writeUint(CBORWriter *writer, uint64_t value);
+
+/**
+ * @brief Writes a signed integer in its shortest form.
+ *
+ * @param writer Pointer to an initialized writer.
+ * @param value The value to write.
+ * @return True if the item was written; false if it does not fit.
+ */
+bool piconfc_CBOR_writeInt(CBORWriter *writer, int64_t value);
+
+/**
+ * @brief Writes a byte string.
+ *
+ * @param writer Pointer to an initialized writer.
+ * @param data Pointer to the bytes.
+ * @param len Number of bytes.
+ * @return True if the item was written; false if it does not fit.
+ */
+bool piconfc_CBOR_writeBytes(CBORWriter *writer, const uint8_t *data, int len);
+
+/**
+ * @brief Writes a UTF-8 text string.
+ *
+ * @param writer Pointer to an initialized writer.
+ * @param text Pointer to the text; it is not validated.
+ * @param len Length of the text in bytes.
+ * @return True if the item was written; false if it does not fit.
+ */
+bool piconfc_CBOR_writeText(CBORWriter *writer, const char *text, int len);
+
+/**
+ * @brief Writes an array header; the `count` items must be written next.
+ *
+ * @param writer Pointer to an initialized writer.
+ * @param count Number of items in the array.
+ * @return True if the header was written; false if it does not fit.
+ */
+bool piconfc_CBOR_writeArray(CBORWriter *writer, uint32_t count);
+
+/**
+ * @brief Writes a map header; the `count` key/value pairs must be written next.
+ *
+ * @param writer Pointer to an initialized writer.
+ * @param count Number of key/value pairs in the map.
+ * @return True if the header was written; false if it does not fit.
+ */
+bool piconfc_CBOR_writeMap(CBORWriter *writer, uint32_t count);
+
+/**
+ * @brief Writes a tag; the tagged item must be written next.
+ *
+ * @param writer Pointer to an initialized writer.
+ * @param tag The tag number.
+ * @return True if the tag was written; false if it does not fit.
+ */
+bool piconfc_CBOR_writeTag(CBORWriter *writer, uint64_t tag);
+
+/**
+ * @brief Writes true or false.
+ *
+ * @param writer Pointer to an initialized writer.
+ * @param value The value to write.
+ * @return True if the item was written; false if it does not fit.
+ */
+bool piconfc_CBOR_writeBool(CBORWriter *writer, bool value);
+
+/**
+ * @brief Writes null.
+ *
+ * @param writer Pointer to an initialized writer.
+ * @return True if the item was written; false if it does not fit.
+ */
+bool piconfc_CBOR_writeNull(CBORWriter *writer);
+
+/**
+ * @brief Writes a single precision float.
+ *
+ * @param writer Pointer to an initialized writer.
+ * @param value The value to write.
+ * @return True if the item was written; false if it does not fit.
+ */
+bool piconfc_CBOR_writeFloat(CBORWriter *writer, float value);
+
+/**
+ * @brief Returns the length of the encoded payload.
+ *
+ * @param writer Pointer to a writer.
+ * @return The number of bytes written; -1 if an item did not fit.
+ */
+int piconfc_CBOR_writerLength(const CBORWriter *writer);
+
+/**
+ * @brief Opens a CBOR record in a message being built and points a writer at its payload.
+ *
+ * The payload is encoded directly into the tag image with `piconfc_NDEF_builderOpenRecord`.
+ * Call `piconfc_CBOR_builderClose` once all items are written.
+ *
+ * @param builder Pointer to an initialized builder.
+ * @param writer Pointer to the writer to initialize over the record payload.
+ * @return True if the record was opened; false if it does not fit.
+ */
+bool piconfc_CBOR_builderOpen(NDEFBuilder *builder, CBORWriter *writer);
+
+/**
+ * @brief Closes the CBOR record opened by `piconfc_CBOR_builderOpen`.
+ *
+ * @param builder Pointer to the builder with the open record.
+ * @param writer Pointer to the writer used for the payload.
+ * @return True if the record was closed; false if the payload did not fit, which also makes
+ *         `piconfc_NDEF_builderFinish` fail.
+ */
+bool piconfc_CBOR_builderClose(NDEFBuilder *builder, CBORWriter *writer);
+
+#endif /* PICONFC_CBOR_H */
@@ -0,0 +1,70 @@
+/**
+ * @file piconfc_FRAME.h
+ * @brief PN532 normal information frame building and validation.
+ *
+ * The PN532 wraps every command and response in the same frame on all of its host interfaces:
+ * preamble, start codes, length, length checksum, frame identifier (TFI), data, data checksum and
+ * postamble. These functions only transform buffers and do not touch any hardware, so they are shared
+ * by all transports and can be built and benchmarked on a host.
+ */
+
+#ifndef PICONFC_FRAME_H
+#define PICONFC_FRAME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PN532_PREAMBLE (0x00)   ///< Command sequence start, byte 1/3
+#define PN532_STARTCODE1 (0x00) ///< Command sequence start, byte 2/3
+#define PN532_STARTCODE2 (0xFF) ///< Command sequence start, byte 3/3
+#define PN532_POSTAMBLE (0x00)  ///< EOD
+
+#define PN532_HOSTTOPN532 (0xD4) ///< Host-to-PN532
+#define PN532_PN532TOHOST (0xD5) ///< PN532-to-host
+
+/**
+ * @brief Bytes a frame adds around the command data: preamble, start codes, LEN, LCS, TFI, DCS and postamble.
+ */
+#define PN532_FRAME_OVERHEAD (8)
+
+/**
+ * @brief Builds a host-to-PN532 frame around a command.
+ *
+ * @param cmd Pointer to the command data, starting with the command code.
+ * @param cmdlen Length of the command data in bytes. At most 254, the largest normal frame.
+ * @param frame Pointer to the buffer receiving the frame.
+ * @param framesize Size of the frame buffer in bytes. `cmdlen + PN532_FRAME_OVERHEAD` is enough.
+ * @return The length of the frame in bytes, or 0 if it does not fit in the buffer.
+ */
+int piconfc_FRAME_build(const uint8_t *cmd, uint8_t cmdlen, uint8_t *frame, int framesize);
+
+/**
+ * @brief Validates a frame received from the PN532 and moves its data to the start of the buffer.
+ *
+ * The preamble, start codes, length checksum and data checksum are checked, and the length is checked
+ * against `len` so a corrupted length byte cannot make the check read past the received bytes. On
+ * success the data following the TFI is moved to `buffer[0]`, as `piconfc_I2C_parseresponse` returns it.
+ *
+ * @param buffer Pointer to the received frame, starting with the preamble.
+ * @param len Number of received bytes in the buffer.
+ * @return The length of the data excluding the TFI, or -1 if the frame is invalid.
+ */
+int piconfc_FRAME_check(uint8_t *buffer, int len);
+
+/**
+ * @brief Finds the first complete frame in a stream of bytes, for interfaces that do not delimit frames.
+ *
+ * Over HSU the PN532 frames arrive as a plain byte stream, possibly behind wake-up bytes, extra
+ * preamble bytes or noise. The search looks for the start codes followed by a length that passes its
+ * checksum, and reports ACK and NACK frames as well as normal frames. The checksums of the data are
+ * left to `piconfc_FRAME_check`.
+ *
+ * @param buffer Pointer to the bytes received so far.
+ * @param len Number of bytes in the buffer.
+ * @param start Set to the offset of the start codes of the frame, or, when no frame is complete yet,
+ *              to the offset the bytes before which can be dropped.
+ * @return The length of the frame from its start codes through the postamble, or 0 if no frame is complete.
+ */
+int piconfc_FRAME_find(const uint8_t *buffer, int len, int *start);
+
+#endif /* PICONFC_FRAME_H */
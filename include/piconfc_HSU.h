@@ -0,0 +1,70 @@
+/**
+ * @file piconfc_HSU.h
+ * @brief High-speed UART (HSU) backend for interfacing with the PN532 NFC module.
+ *
+ * Over HSU the PN532 has no status byte and no chip select: frames arrive as a plain byte stream
+ * whenever the PN532 sends them. This backend collects the received bytes and reassembles them into
+ * frames with `piconfc_FRAME_find`, and a frame being complete is what makes the transport ready.
+ *
+ * The PN532 starts asleep at 115200 baud. The first frame sent is preceded by the 0x55 wake-up
+ * preamble, and `piconfc_initHSU` can then move both sides to a faster rate with SetSerialBaudRate.
+ *
+ * Frames and the command sequence are shared with I2C through the transport in `piconfc_I2C.h`.
+ */
+
+#ifndef PICONFC_HSU_H
+#define PICONFC_HSU_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "hardware/uart.h"
+#include "piconfc_I2C.h"
+
+#define PICONFC_HSU_BAUD (115200)     ///< Rate the PN532 starts at
+#define PICONFC_HSU_MAX_BAUD (921600) ///< Fastest rate negotiated with SetSerialBaudRate
+#define PICONFC_HSU_BUFSIZE (264)     ///< Received bytes held for reassembly, one frame of the largest size
+
+/**
+ * @brief A PN532 on a Pico UART, with the bytes received but not yet read as frames.
+ */
+typedef struct {
+    uart_inst_t *block;               // UART instance the PN532 is on
+    uint32_t baudrate;                // Rate the UART runs at
+    bool awake;                       // Whether the wake-up preamble has been sent
+    uint8_t rx[PICONFC_HSU_BUFSIZE];  // Received bytes, starting at the frame being reassembled
+    int rx_len;                       // Number of bytes in rx
+    int frame_len;                    // Length of the complete frame at the start of rx, 0 if none yet
+} PicoNFCHSUBus;
+
+/**
+ * @brief Initializes the UART and pins for a PN532 at `PICONFC_HSU_BAUD`.
+ *
+ * @param bus Pointer to the bus to initialize.
+ * @param block Pointer to the UART instance to initialize (e.g., uart0 or uart1).
+ * @param tx_pin GPIO pin to use for TX (host to PN532).
+ * @param rx_pin GPIO pin to use for RX (PN532 to host).
+ */
+void piconfc_HSU_init(PicoNFCHSUBus *bus, uart_inst_t *block, uint8_t tx_pin, uint8_t rx_pin);
+
+/**
+ * @brief Sets up a transport that reaches the PN532 on a Pico UART.
+ *
+ * Waiting for readiness sleeps until bytes arrive rather than polling every millisecond.
+ *
+ * @param transport Pointer to the transport to set up.
+ * @param bus Pointer to the bus, initialized with `piconfc_HSU_init`, which must outlive the transport.
+ */
+void piconfc_HSU_transport(PicoNFCTransport *transport, PicoNFCHSUBus *bus);
+
+/**
+ * @brief Changes the rate of the host side of the UART.
+ *
+ * Call this after `piconfc_PN532_setSerialBaudRate` has succeeded, which switches the PN532 side.
+ * Bytes still being sent go out at the old rate first; bytes received so far are discarded.
+ *
+ * @param bus Pointer to the bus.
+ * @param baudrate New rate in baud.
+ */
+void piconfc_HSU_setBaudRate(PicoNFCHSUBus *bus, uint32_t baudrate);
+
+#endif /* PICONFC_HSU_H */
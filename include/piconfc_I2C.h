@@ -14,16 +14,48 @@
  * - Reading data and validating response packets
  *
  * These functions are meant to be used as a low-level API for higher-level NFC operations.
+ *
+ * The command sequence runs on a `PicoNFCTransport`, so the same code drives the PN532 over any bus
+ * a backend provides. `piconfc_I2C_transport` sets up the Pico I2C backend.
  */
 
 #ifndef PICONFC_I2C_H
 #define PICONFC_I2C_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include "hardware/i2c.h"
 
 #define PICONFC_I2C_FREQ (400 * 1000)
 
+extern const uint8_t PN532_ACK[6]; ///< ACK frame, as the PN532 sends it and as the host sends it over HSU
+
+/**
+ * @brief A PN532 host interface: the seam between the frame protocol and the bus it travels on.
+ *
+ * The PN532 uses the same frames on every interface; only moving the bytes and detecting readiness
+ * differ. A backend fills in these operations and keeps its bus state in `ctx`, and the functions in
+ * this file run the command sequence (frame, ACK, response) on top of them.
+ */
+typedef struct PicoNFCTransport PicoNFCTransport;
+struct PicoNFCTransport {
+    bool (*isready)(PicoNFCTransport *transport);                             // Whether a frame is ready to be read
+    bool (*write)(PicoNFCTransport *transport, const uint8_t *data, int len); // Sends a frame
+    bool (*read)(PicoNFCTransport *transport, uint8_t *data, int len);        // Reads the ready frame, without any status byte
+    bool (*waitready)(PicoNFCTransport *transport, int timeout_ms);           // Waits for a frame; NULL polls isready every ms
+    void *ctx;                                                                // Bus state of the backend
+};
+
+/**
+ * @brief Sets up a transport that reaches the PN532 on a Pico I2C block.
+ *
+ * Readiness is the status byte the PN532 sends before every I2C read, polled every millisecond.
+ *
+ * @param transport Pointer to the transport to set up.
+ * @param block Pointer to the I2C instance, initialized with `piconfc_I2C_init`.
+ */
+void piconfc_I2C_transport(PicoNFCTransport *transport, i2c_inst_t *block);
+
 /**
  * @brief Initializes the I2C bus and configures the specified pins.
  *
@@ -43,23 +75,24 @@ void piconfc_I2C_init(i2c_inst_t *block, uint8_t sda_pin, uint8_t scl_pin);
  * This function reads a single byte from the PN532 and checks if it matches
  * the `PN532_I2C_READY` value, indicating that the device is ready.
  *
- * @param block Pointer to the I2C instance to use (e.g., i2c0 or i2c1).
+ * @param transport Pointer to the transport the PN532 is reached through.
  * @return True if the PN532 is ready; false otherwise.
  */
-bool piconfc_I2C_isready(i2c_inst_t* block);
+bool piconfc_I2C_isready(PicoNFCTransport *transport);
 
 /**
  * @brief Waits until the PN532 is ready or a timeout occurs.
  *
- * This function repeatedly checks if the PN532 is ready by calling `piconfc_I2C_isready`.
+ * This function repeatedly checks if the PN532 is ready by calling `piconfc_I2C_isready`, unless the
+ * transport provides its own `waitready`.
  * If the device does not become ready within the specified timeout (in milliseconds),
  * the function returns false. If the timeout is set to 0, it will wait indefinitely.
  *
- * @param block Pointer to the I2C instance to use (e.g., i2c0 or i2c1).
+ * @param transport Pointer to the transport the PN532 is reached through.
  * @param timeout Maximum time to wait in milliseconds (0 for indefinite wait).
  * @return True if the PN532 is ready; false if the timeout is reached.
  */
-bool piconfc_I2C_waitready(i2c_inst_t* block, int timeout);
+bool piconfc_I2C_waitready(PicoNFCTransport *transport, int timeout);
 
 /**
  * @brief Sends a command to the PN532 and waits for an acknowledgment.
@@ -68,13 +101,13 @@ bool piconfc_I2C_waitready(i2c_inst_t* block, int timeout);
  * waits for the device to be ready. It checks for an acknowledgment (ACK) within the specified
  * timeout period. If the ACK is received and the device becomes ready again, the function returns true.
  *
- * @param block Pointer to the I2C instance to use (e.g., i2c0 or i2c1).
+ * @param transport Pointer to the transport the PN532 is reached through.
  * @param cmd Pointer to the command data to send.
  * @param len Length of the command data in bytes.
  * @param timeout Maximum time to wait for an acknowledgment in milliseconds.
  * @return True if the command was acknowledged within the timeout; false otherwise.
  */
-bool piconfc_I2C_sendcommand_andack(i2c_inst_t* block, uint8_t * cmd, uint8_t len, int timeout);
+bool piconfc_I2C_sendcommand_andack(PicoNFCTransport *transport, uint8_t * cmd, uint8_t len, int timeout);
 
 /**
  * @brief Reads data from the PN532 and checks for an acknowledgment (ACK).
@@ -83,35 +116,36 @@ bool piconfc_I2C_sendcommand_andack(i2c_inst_t* block, uint8_t * cmd, uint8_t le
  * the received data with the expected ACK pattern (`PN532_ACK`). If the received
  * data matches the ACK, the function returns true.
  *
- * @param block Pointer to the I2C instance to use (e.g., i2c0 or i2c1).
+ * @param transport Pointer to the transport the PN532 is reached through.
  * @return True if the received data matches the expected ACK; false otherwise.
  */
-bool piconfc_I2C_readack(i2c_inst_t* block);
+bool piconfc_I2C_readack(PicoNFCTransport *transport);
 
 /**
  * @brief Reads a specified number of bytes from the PN532 into a buffer.
  *
- * This function reads `len + 1` bytes from the PN532. The first byte is a ready (RDY) byte,
- * which is ignored, and the remaining `len` bytes are copied into the provided buffer.
+ * This function reads `len` bytes of the ready frame through the transport. On I2C the PN532
+ * sends a ready (RDY) byte first, which the backend reads and drops.
  *
- * @param block Pointer to the I2C instance to use (e.g., i2c0 or i2c1).
+ * @param transport Pointer to the transport the PN532 is reached through.
  * @param buffer Pointer to the buffer where the data will be stored.
  * @param len Number of data bytes to read from the PN532 (excluding the RDY byte).
+ * @return True if all bytes were read; false if the transfer failed.
  */
-void piconfc_I2C_readdata(i2c_inst_t* block, uint8_t * buffer, uint8_t len);
+bool piconfc_I2C_readdata(PicoNFCTransport *transport, uint8_t * buffer, uint8_t len);
 
 /**
- * @brief Writes a command packet to the PN532 over I2C.
+ * @brief Writes a command packet to the PN532 through the transport.
  *
  * This function constructs a command packet with the specified command data and length, 
  * following the PN532 protocol. It includes preamble, start codes, length, checksum, 
  * and postamble fields. The packet is then sent to the PN532.
  *
- * @param block Pointer to the I2C instance to use (e.g., i2c0 or i2c1).
+ * @param transport Pointer to the transport the PN532 is reached through.
  * @param cmd Pointer to the command data to send.
  * @param cmdlen Length of the command data in bytes.
  */
-void piconfc_I2C_writecommand(i2c_inst_t* block, uint8_t * cmd, uint8_t cmdlen);
+void piconfc_I2C_writecommand(PicoNFCTransport *transport, uint8_t * cmd, uint8_t cmdlen);
 
 /**
  * @brief Parses a response from the PN532 and validates the packet structure.
@@ -120,13 +154,13 @@ void piconfc_I2C_writecommand(i2c_inst_t* block, uint8_t * cmd, uint8_t cmdlen);
  * the preamble, start codes, and checksums, and extracts the command ID and data length.
  * The buffer should be large enough to hold `expected_data_len + 8` bytes.
  *
- * @param block Pointer to the I2C instance to use (e.g., i2c0 or i2c1).
+ * @param transport Pointer to the transport the PN532 is reached through.
  * @param buffer Pointer to the buffer where the response will be stored.
  * @param expected_data_len Expected length of the response data, in bytes.
  * @return Length of the response data (excluding the PN532 indicator) if successful;
  *         0 if there was an error in validation.
  */
-uint8_t piconfc_I2C_parseresponse(i2c_inst_t *block, uint8_t *buffer, uint8_t expected_data_len);
+uint8_t piconfc_I2C_parseresponse(PicoNFCTransport *transport, uint8_t *buffer, uint8_t expected_data_len);
 
 // Does what it says
 void printhex(uint8_t *buff, int len);
@@ -0,0 +1,128 @@
+/**
+ * @file piconfc_LZ.h
+ * @brief A small LZ77 codec for compressing NDEF payloads stored on tags.
+ *
+ * Tag read time grows with the number of bytes stored, and configuration payloads such as JSON
+ * repeat the same keys and values over and over. This module compresses such payloads into an
+ * external-type NDEF record (`LZ_EXTERNAL_TYPE`) and decodes them straight from the read buffer
+ * into a caller buffer. The codec needs no heap and about 1 KB of stack to compress; decoding
+ * needs no memory beyond the destination buffer. An optional dictionary shared by writer and
+ * reader, such as the keys of a JSON schema, lets even the first occurrence of a string be
+ * encoded as a match.
+ *
+ * A compressed payload is a 3-byte header (flags, then the uncompressed length, big endian),
+ * followed by a dictionary ID byte if the dictionary flag is set, followed by tokens:
+ * - `0nnnnnnn`: n + 1 literal bytes follow.
+ * - `1LLLLooo oooooooo`: copy L + 3 bytes from o + 1 bytes back in the output (or dictionary).
+ *   If L is 15, one more byte follows and is added to the length.
+ */
+
+#ifndef PICONFC_LZ_H
+#define PICONFC_LZ_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "piconfc_NDEF.h"
+
+/**
+ * @brief Type of the external (TNF_EXTERNAL) records carrying compressed payloads.
+ */
+#define LZ_EXTERNAL_TYPE "piconfc:lz"
+
+#define LZ_FLAG_DICT (0x01)   ///< Header flag: the payload was compressed with a dictionary
+#define LZ_HEADER_LEN (3)     ///< Flags and uncompressed length, excluding the dictionary ID
+#define LZ_MAX_OFFSET (2048)  ///< Farthest back a match can reach
+#define LZ_MAX_PAYLOAD (1024) ///< Largest compressed payload built by piconfc_LZ_createRecord
+
+/**
+ * @brief Sets the dictionary used by `piconfc_LZ_createRecord` and by the NDEF string readers.
+ *
+ * Only the last `LZ_MAX_OFFSET` bytes of the dictionary can be referenced. The dictionary is not
+ * copied. A 1-byte ID derived from its contents is stored in each payload, so a payload is not
+ * decoded with the wrong dictionary.
+ *
+ * @param dict Pointer to the dictionary, or NULL to compress without one.
+ * @param dictlen Length of the dictionary in bytes.
+ */
+void piconfc_LZ_setDictionary(const uint8_t *dict, int dictlen);
+
+/**
+ * @brief Compresses a buffer.
+ *
+ * Matches are found greedily with a 512-entry hash table of 3-byte sequences.
+ *
+ * @param src Pointer to the data to compress.
+ * @param srclen Length of the data in bytes, at most 65535.
+ * @param dest Pointer to the buffer receiving the compressed payload.
+ * @param destsize Size of the destination buffer in bytes.
+ * @param dict Pointer to a dictionary, or NULL.
+ * @param dictlen Length of the dictionary in bytes.
+ * @return The length of the compressed payload; 0 if it does not fit in the destination buffer.
+ */
+int piconfc_LZ_compress(const uint8_t *src, int srclen, uint8_t *dest, int destsize, const uint8_t *dict, int dictlen);
+
+/**
+ * @brief Decompresses a payload into a caller buffer.
+ *
+ * Works like `snprintf`: if the destination buffer is too small, only its first `destsize` bytes
+ * are written, and the full uncompressed length is still returned. No null terminator is added.
+ * The whole payload is decoded and checked whatever the size of the destination, so passing a NULL
+ * destination measures the payload and validates it at the same time.
+ *
+ * @param src Pointer to the compressed payload, e.g. a slice of the read buffer.
+ * @param srclen Length of the compressed payload in bytes.
+ * @param dest Pointer to the destination buffer, may be NULL if `destsize` is 0.
+ * @param destsize Size of the destination buffer in bytes.
+ * @param dict Pointer to the dictionary the payload was compressed with, or NULL.
+ * @param dictlen Length of the dictionary in bytes.
+ * @return The uncompressed length; -1 if the payload is malformed or needs a different dictionary.
+ */
+int piconfc_LZ_decompress(const uint8_t *src, int srclen, uint8_t *dest, int destsize, const uint8_t *dict, int dictlen);
+
+/**
+ * @brief Decompresses the payload of a compressed record with the dictionary set by `piconfc_LZ_setDictionary`.
+ *
+ * @param record Pointer to a record of type `LZ_EXTERNAL_TYPE`.
+ * @param dest Pointer to the destination buffer, may be NULL if `destsize` is 0.
+ * @param destsize Size of the destination buffer in bytes.
+ * @return The uncompressed length; -1 if the record is not compressed or is malformed.
+ */
+int piconfc_LZ_decodeRecord(const NDEFRecord *record, uint8_t *dest, int destsize);
+
+/**
+ * @brief Checks whether a record holds a compressed payload.
+ *
+ * @param record Pointer to a parsed record.
+ * @return True if the record is of external type `LZ_EXTERNAL_TYPE`; false otherwise.
+ */
+bool piconfc_LZ_isCompressed(const NDEFRecord *record);
+
+/**
+ * @brief Creates a record with a compressed payload, like `piconfc_NDEF_createRecord`.
+ *
+ * The payload is compressed with the dictionary set by `piconfc_LZ_setDictionary` and stored in a
+ * record of external type `LZ_EXTERNAL_TYPE`. `piconfc_NDEF_readPayloadString` and
+ * `piconfc_NDEF_copyPayloadString` decompress such records transparently.
+ *
+ * @param dest Pointer to a buffer pointer where the created record will be stored.
+ *             The caller is responsible for freeing this buffer with `piconfc_NDEF_free`.
+ * @param recordlen Pointer to an unsigned int where the length of the created record will be stored.
+ * @param payload Pointer to the payload to compress.
+ * @param payloadlen Length of the payload in bytes.
+ * @return True if the record was created; false if the compressed payload is larger than
+ *         `LZ_MAX_PAYLOAD` or memory allocation failed.
+ */
+bool piconfc_LZ_createRecord(uint8_t **dest, unsigned int *recordlen, uint8_t *payload, unsigned int payloadlen);
+
+/**
+ * @brief Appends a record with a compressed payload to a message being built.
+ *
+ * @param builder Pointer to an initialized builder.
+ * @param payload Pointer to the payload to compress.
+ * @param payloadlen Length of the payload in bytes.
+ * @return True if the record was appended; false if the compressed payload is larger than
+ *         `LZ_MAX_PAYLOAD` or does not fit.
+ */
+bool piconfc_LZ_builderAddRecord(NDEFBuilder *builder, uint8_t *payload, unsigned int payloadlen);
+
+#endif /* PICONFC_LZ_H */
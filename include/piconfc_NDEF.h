@@ -11,6 +11,7 @@
 #ifndef NDEF_H
 #define NDEF_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -56,6 +57,53 @@
 #define NDEF_URIPREFIX_URN_NFC (0x23)      ///< URN NFC
 ///@}
 
+/** @name TLV Block Tags
+ *  Tags of the TLV blocks found in the data area of a Type 2 tag.
+ */
+///@{
+#define NDEF_TLV_NULL (0x00)           ///< Padding byte, has no length or value
+#define NDEF_TLV_LOCK_CONTROL (0x01)   ///< Location of the dynamic lock bits
+#define NDEF_TLV_MEMORY_CONTROL (0x02) ///< Location of reserved memory
+#define NDEF_TLV_NDEF (0x03)           ///< NDEF message
+#define NDEF_TLV_PROPRIETARY (0xFD)    ///< Proprietary data
+#define NDEF_TLV_TERMINATOR (0xFE)     ///< Last TLV, has no length or value
+///@}
+
+/** @name NDEF Record Header Flags
+ *  Flags in the first byte of a record header, above the 3-bit TNF.
+ */
+///@{
+#define NDEF_FLAG_MB (0x80) ///< Message Begin
+#define NDEF_FLAG_ME (0x40) ///< Message End
+#define NDEF_FLAG_CF (0x20) ///< Chunk Flag, set on every chunk but the last
+#define NDEF_FLAG_SR (0x10) ///< Short Record, 1-byte payload length
+#define NDEF_FLAG_IL (0x08) ///< ID Length field present
+///@}
+
+#define NDEF_MAX_CHUNKS (8) ///< Chunks of one logical record held by an NDEFChunkedRecord
+#define NDEF_MAX_DEPTH (4)  ///< Deepest nested message reachable with piconfc_NDEF_iteratorDescend
+
+#define NDEF_DISPATCH_SLOTS (16)       ///< Hash table size of an NDEFDispatcher, a power of two
+#define NDEF_DISPATCH_MAX_HANDLERS (12) ///< Handlers an NDEFDispatcher holds, keeping the table 3/4 full at most
+
+#define NDEF_INDEX_SLOTS (64)       ///< Hash table size of each NDEFIndex table, a power of two
+#define NDEF_INDEX_MAX_RECORDS (48) ///< Distinct keys indexed per table, keeping it 3/4 full at most
+
+/** @name Smart Poster Actions
+ *  Values of the action record of a Smart Poster.
+ */
+///@{
+#define NDEF_SP_ACTION_NONE (-1) ///< No action record
+#define NDEF_SP_ACTION_DO (0)    ///< Do the action (e.g., open the URI)
+#define NDEF_SP_ACTION_SAVE (1)  ///< Save for later
+#define NDEF_SP_ACTION_OPEN (2)  ///< Open for editing
+///@}
+
+#define NDEF_IMAGE_ALIGN (4) ///< Builder images are padded to whole tag pages (NTAG_PAGE_SIZE)
+
+#define NDEF_TLV_MAX_BLOCKS (8)   ///< TLV blocks recorded by piconfc_NDEF_walkTLV
+#define NDEF_TLV_MAX_RESERVED (4) ///< Reserved areas recorded by piconfc_NDEF_walkTLV
+
 /**
  * @brief Represents a Tag-Length-Value (TLV) structure.
  *
@@ -69,6 +117,41 @@ struct TLV {
     uint8_t * value_ptr;
 };
 
+/**
+ * @brief A single TLV block found by `piconfc_NDEF_walkTLV`.
+ */
+struct TLVBlock {
+    uint8_t tag;           ///< One of the NDEF_TLV_* tags
+    int offset;            ///< Offset of the tag byte in the walked buffer
+    int value_offset;      ///< Offset of the value in the walked buffer
+    uint16_t value_length; ///< Length of the value in bytes
+};
+
+/**
+ * @brief A memory area that must not be overwritten with user data.
+ *
+ * Areas come from Lock Control and Memory Control TLVs. The address is an absolute byte
+ * address on the tag (page * 4 + byte), not an offset in the walked buffer.
+ */
+struct TLVArea {
+    int address; ///< Absolute byte address of the first reserved byte
+    int length;  ///< Number of reserved bytes
+    bool lock;   ///< True for dynamic lock bytes, false for reserved memory
+};
+
+/**
+ * @brief The layout of a tag's data area as found by `piconfc_NDEF_walkTLV`.
+ */
+struct TLVMap {
+    struct TLVBlock blocks[NDEF_TLV_MAX_BLOCKS];    ///< TLV blocks in the order found, excluding NULL TLVs
+    int block_count;                                ///< Number of entries in blocks
+    struct TLVArea reserved[NDEF_TLV_MAX_RESERVED]; ///< Reserved areas announced by control TLVs
+    int reserved_count;                             ///< Number of entries in reserved
+    int ndef_block;                                 ///< Index of the first NDEF TLV in blocks, or -1
+    bool terminated;                                ///< Whether a Terminator TLV ended the walk
+    int stop_offset;                                ///< Offset where the walk stopped: a terminator, a truncated block or the end
+};
+
 /**
  * @brief Enumeration for Type Name Format (TNF) values.
  *
@@ -94,6 +177,7 @@ enum TNF {
 typedef struct {
     uint8_t * buffer;
     enum TNF tnf;
+    uint8_t flags; ///< Header flags (NDEF_FLAG_*) without the TNF
     int data_offset;
     int data_length;
     uint8_t id_length;
@@ -102,19 +186,264 @@ typedef struct {
     int type_offset;
 } NDEFRecord;
 
+/**
+ * @brief A read-only view of part of a buffer.
+ *
+ * Slices point into the buffer a record was parsed from and are not null-terminated.
+ */
+typedef struct {
+    const uint8_t * ptr;
+    int len;
+} NDEFSlice;
+
+/**
+ * @brief A logical record whose payload may be split over chunked records (CF flag).
+ *
+ * The payload is exposed as a scatter list of slices pointing into the parsed buffer, one per
+ * chunk, so nothing is copied unless `piconfc_NDEF_gatherPayload` is called. An unchunked record
+ * has a single slice.
+ */
+typedef struct {
+    NDEFRecord first;                     ///< First chunk, carrying the TNF, type and ID of the record
+    NDEFSlice chunks[NDEF_MAX_CHUNKS];    ///< Payload of each chunk in order
+    int chunk_count;                      ///< Number of entries in chunks
+    uint32_t payload_length;              ///< Total payload length over all chunks
+} NDEFChunkedRecord;
+
+/**
+ * @brief The fields of a well-known Text ('T') record payload.
+ *
+ * The language code and text are slices into the record buffer.
+ */
+typedef struct {
+    bool utf16;         ///< Encoding flag of the status byte: UTF-16 if set, UTF-8 otherwise
+    NDEFSlice language; ///< IANA language code, e.g. "en"
+    NDEFSlice text;     ///< Encoded text, not null-terminated
+} NDEFText;
+
+/**
+ * @brief Callback receiving consecutive pieces of a string written by `piconfc_NDEF_writePayloadString`.
+ *
+ * @param ctx The context pointer passed to the writer.
+ * @param data Pointer to the next piece. Not null-terminated.
+ * @param len Length of the piece in bytes.
+ */
+typedef void (*NDEFSink)(void *ctx, const uint8_t *data, int len);
+
+/**
+ * @brief Iterator over the records of an NDEF message.
+ *
+ * The iterator walks an NDEF message in a single pass without allocating. Each call to
+ * `piconfc_NDEF_iteratorNext` fills an `NDEFRecord` view whose offsets point into the
+ * iterated buffer, so the buffer must outlive the records produced from it.
+ */
+typedef struct {
+    uint8_t * buffer;
+    int bufsize;
+    int offset; ///< Offset of the next record in the buffer
+    int depth;  ///< Nesting level, 0 for a top-level message
+    bool done;  ///< Set after the Message End record or on a malformed record
+} NDEFIterator;
+
+/**
+ * @brief The fields of a Smart Poster ('Sp') record.
+ *
+ * The records are views into the buffer of the Smart Poster, which must outlive this structure.
+ */
+typedef struct {
+    NDEFRecord uri;   ///< The URI ('U') record
+    bool has_uri;     ///< Always true after a successful parse
+    NDEFText title;   ///< The first title ('T') record
+    bool has_title;   ///< Whether a title was found
+    int action;       ///< One of the NDEF_SP_ACTION_* values
+    uint32_t size;    ///< Size of the referenced content in bytes, or 0 if not given
+    NDEFSlice type;   ///< MIME type of the referenced content, empty if not given
+} NDEFSmartPoster;
+
+/**
+ * @brief Allocator hooks used for every allocation made by the NDEF functions.
+ *
+ * The hooks default to `malloc`, `realloc` and `free`. They are meant to be set once at
+ * initialization with `piconfc_NDEF_setAllocator`, e.g. to an `NDEFArena`.
+ */
+typedef struct {
+    void *(*alloc)(void *ctx, size_t size);                                     ///< Returns NULL on failure
+    void *(*realloc)(void *ctx, void *ptr, size_t old_size, size_t new_size);   ///< ptr may be NULL
+    void (*free)(void *ctx, void *ptr);                                         ///< Never called with NULL
+    void *ctx;                                                                  ///< Passed to every hook
+} NDEFAllocator;
+
+/**
+ * @brief Counters of the allocations made through the allocator hooks.
+ */
+typedef struct {
+    uint32_t allocations;     ///< Successful allocations
+    uint32_t reallocations;   ///< Successful reallocations
+    uint32_t frees;           ///< Calls to piconfc_NDEF_free with a non-NULL pointer
+    uint32_t failures;        ///< Allocations and reallocations that returned NULL
+    uint32_t bytes_allocated; ///< Total bytes requested by successful allocations and growth
+} NDEFAllocStats;
+
+/**
+ * @brief A bump allocator over a fixed buffer.
+ *
+ * Allocations are carved from the buffer in order and are never freed individually; the whole
+ * arena is released at once with `piconfc_NDEF_arenaReset`. This gives bounded memory use with no
+ * fragmentation. The most recent allocation can grow in place, which suits the growing record
+ * array of `piconfc_NDEF_parseMessage`.
+ */
+typedef struct {
+    uint8_t * buffer;
+    size_t size;
+    size_t used; ///< Bytes in use, including alignment padding
+    size_t last; ///< Offset of the most recent allocation
+    size_t peak; ///< Highest value of used since the arena was initialized
+} NDEFArena;
+
+/**
+ * @brief Sets the allocator hooks used by the NDEF functions.
+ *
+ * Memory returned by the NDEF functions must be released with `piconfc_NDEF_free` while the same
+ * hooks are installed.
+ *
+ * @param allocator Pointer to the hooks, which are copied; NULL restores the C heap.
+ */
+void piconfc_NDEF_setAllocator(const NDEFAllocator *allocator);
+
+/**
+ * @brief Releases memory returned by an NDEF function through the current allocator hooks.
+ *
+ * @param ptr Pointer to release; NULL is ignored.
+ */
+void piconfc_NDEF_free(void *ptr);
+
+/**
+ * @brief Reads the allocation counters.
+ *
+ * @param stats Pointer to a structure to fill with the counters.
+ */
+void piconfc_NDEF_allocStats(NDEFAllocStats *stats);
+
+/**
+ * @brief Resets the allocation counters to zero.
+ */
+void piconfc_NDEF_resetAllocStats(void);
+
+/**
+ * @brief Prepares an arena over a caller-provided buffer.
+ *
+ * @param arena Pointer to the arena to initialize.
+ * @param buffer Pointer to the memory handed out by the arena.
+ * @param size Size of the buffer in bytes.
+ */
+void piconfc_NDEF_arenaInit(NDEFArena *arena, uint8_t *buffer, size_t size);
+
+/**
+ * @brief Releases every allocation of an arena at once.
+ *
+ * Pointers previously returned from the arena must not be used afterwards. The peak usage is kept.
+ *
+ * @param arena Pointer to an initialized arena.
+ */
+void piconfc_NDEF_arenaReset(NDEFArena *arena);
+
+/**
+ * @brief Fills allocator hooks that allocate from an arena.
+ *
+ * Pass the result to `piconfc_NDEF_setAllocator`. Freeing through these hooks does nothing.
+ *
+ * @param arena Pointer to an initialized arena, which must outlive the hooks.
+ * @param allocator Pointer to the hooks to fill.
+ */
+void piconfc_NDEF_arenaAllocator(NDEFArena *arena, NDEFAllocator *allocator);
+
+/**
+ * @brief Callback invoked by `piconfc_NDEF_dispatch` for a record of a registered type.
+ *
+ * @param ctx The context pointer given when the handler was registered.
+ * @param record Pointer to a view of the record in the dispatched buffer, valid during the call.
+ */
+typedef void (*NDEFHandler)(void *ctx, const NDEFRecord *record);
+
+/**
+ * @brief A registered (TNF, type) pair and its handler.
+ */
+typedef struct {
+    uint32_t hash;         ///< Hash of the TNF and type
+    enum TNF tnf;
+    uint8_t type_length;
+    const uint8_t * type;  ///< Not copied, must outlive the dispatcher
+    NDEFHandler handler;   ///< NULL for an empty slot
+    void *ctx;
+} NDEFDispatchEntry;
+
+/**
+ * @brief Routes records to handlers by TNF and type.
+ *
+ * Handlers are kept in a fixed-size open-addressing hash table keyed on the FNV-1a hash of the TNF
+ * and type, so finding the handler of a record takes O(1) probes instead of comparing its type
+ * with every registered type. The table is filled once at initialization and does not allocate.
+ */
+typedef struct {
+    NDEFDispatchEntry slots[NDEF_DISPATCH_SLOTS];
+    int count; ///< Number of registered handlers
+} NDEFDispatcher;
+
+/**
+ * @brief A slot of an `NDEFIndex` table.
+ */
+typedef struct {
+    uint16_t offset; ///< Offset of the record in the indexed buffer plus 1, or 0 for an empty slot
+    uint16_t tag;    ///< Upper 16 bits of the key hash
+} NDEFIndexEntry;
+
+/**
+ * @brief An index of the records of a message by type and by ID.
+ *
+ * Built in a single pass with `piconfc_NDEF_indexBuild`, the index maps the hash of each record's
+ * TNF and type, and of its ID, to the record's offset in two open-addressing tables. Finding a
+ * record then takes O(1) probes instead of a walk over the message. The index holds offsets, not
+ * copies, so the indexed buffer must outlive it. It does not allocate and takes 512 bytes.
+ */
+typedef struct {
+    uint8_t * buffer;
+    int bufsize;
+    NDEFIndexEntry by_type[NDEF_INDEX_SLOTS];
+    NDEFIndexEntry by_id[NDEF_INDEX_SLOTS];
+    int record_count; ///< Number of records in the message
+    bool complete;    ///< False if some keys did not fit; lookups of those fall back to a walk
+} NDEFIndex;
+
+/**
+ * @brief Walks the TLV blocks of a Type 2 tag data area.
+ *
+ * The walk steps from one TLV block to the next using each block's length, so it takes
+ * O(number of TLVs) steps and never mistakes a 0x03 byte inside another block for an NDEF TLV.
+ * NULL TLVs (0x00) are skipped, Lock Control (0x01) and Memory Control (0x02) TLVs are decoded
+ * into reserved areas, and the walk stops at the Terminator TLV (0xFE), at the end of the buffer,
+ * or at a block whose value does not fit in the buffer. Blocks and areas beyond the capacity of
+ * the map are walked over but not recorded.
+ *
+ * @param map Pointer to a TLVMap to be filled.
+ * @param buffer Pointer to the data area, starting at page 4 of the tag.
+ * @param bufsize Size of the buffer in bytes.
+ * @param start Offset in the buffer at which the first TLV block starts.
+ * @return True if an NDEF TLV was found; false otherwise. The map is filled in either case.
+ */
+bool piconfc_NDEF_walkTLV(struct TLVMap *map, uint8_t *buffer, int bufsize, int start);
+
 /**
  * @brief Parses a TLV (Tag-Length-Value) structure from an NTAG buffer.
  *
- * This function searches for a TLV structure within the provided buffer, starting from
- * the specified offset. If a valid TLV structure with a data tag (0x03) is found, it
- * populates the `empty_TLV` struct with the value's length and offset within the buffer.
- * The start parameter allows searching from a specific position in the buffer, with
- * `start = 0` being the default for a fresh search.
+ * This function walks the TLV blocks of the buffer with `piconfc_NDEF_walkTLV`, starting
+ * from the specified offset. If an NDEF TLV (0x03) is found, it populates the `empty_TLV`
+ * struct with the value's length and offset within the buffer. The start parameter is the
+ * offset of the first TLV block, with `start = 0` being the default for a tag's data area.
  *
  * @param empty_TLV Pointer to a TLV structure to be filled with parsed data.
  * @param buffer Pointer to the buffer containing the NTAG data.
  * @param bufsize Size of the buffer in bytes.
- * @param start Starting offset in the buffer for searching the TLV.
+ * @param start Offset in the buffer of the first TLV block.
  * @return True if a valid TLV structure is found and parsed successfully, false otherwise.
  */
 bool piconfc_NDEF_parseTLV(struct TLV *empty_TLV, uint8_t *buffer, int bufsize, int start);
@@ -136,17 +465,247 @@ bool piconfc_NDEF_parseTLV(struct TLV *empty_TLV, uint8_t *buffer, int bufsize,
  */
 int piconfc_NDEF_encodeTLV(uint8_t *data, uint16_t datasize, uint8_t *result, int resultsize);
 
+/**
+ * @brief Prepares an iterator over the NDEF message in a buffer.
+ *
+ * @param it Pointer to the iterator to initialize.
+ * @param buffer Pointer to the buffer containing the NDEF message, e.g. `TLV.value_ptr`.
+ * @param bufsize Size of the message in bytes.
+ */
+void piconfc_NDEF_iteratorInit(NDEFIterator *it, uint8_t *buffer, int bufsize);
+
+/**
+ * @brief Parses the next record of the message.
+ *
+ * The record is parsed in place with `piconfc_NDEF_parseRecord`. Iteration ends after the
+ * record with the ME (Message End) flag, at the end of the buffer, or at the first record
+ * that does not fit in the buffer.
+ *
+ * @param it Pointer to an initialized iterator.
+ * @param record Pointer to an `NDEFRecord` structure to populate with the next record.
+ * @return True if a record was parsed; false if there are no more records.
+ */
+bool piconfc_NDEF_iteratorNext(NDEFIterator *it, NDEFRecord *record);
+
+/**
+ * @brief Prepares an iterator over the NDEF message embedded in a record's payload.
+ *
+ * Container records such as Smart Posters and handover records carry a full NDEF message as their
+ * payload. The child iterator works like any other: nothing is parsed or allocated until
+ * `piconfc_NDEF_iteratorNext` is called on it, so nested messages are only parsed when descended
+ * into. The child's depth is one more than the parent's.
+ *
+ * @param parent Pointer to the iterator that produced the record.
+ * @param record Pointer to the container record.
+ * @param child Pointer to the iterator to initialize over the record's payload.
+ * @return True if the child iterator was initialized; false if it would be nested deeper than
+ *         `NDEF_MAX_DEPTH`.
+ */
+bool piconfc_NDEF_iteratorDescend(const NDEFIterator *parent, const NDEFRecord *record, NDEFIterator *child);
+
+/**
+ * @brief Parses the next logical record of the message, joining chunked records.
+ *
+ * A record with the CF flag starts a chunked record: it and the following chunks, which must have
+ * TNF `TNF_UNCHANGED`, no type and no ID, up to the chunk without the CF flag are returned as one
+ * record. Unlike `piconfc_NDEF_iteratorNext`, which returns each chunk separately, the caller
+ * sees the logical record. Nothing is copied.
+ *
+ * @param it Pointer to an initialized iterator.
+ * @param record Pointer to an `NDEFChunkedRecord` to populate.
+ * @return True if a record was parsed; false if there are no more records, or if a chunked record
+ *         is malformed or has more than `NDEF_MAX_CHUNKS` chunks, which also ends the iteration.
+ */
+bool piconfc_NDEF_iteratorNextChunked(NDEFIterator *it, NDEFChunkedRecord *record);
+
+/**
+ * @brief Copies the payload of a chunked record into one contiguous buffer.
+ *
+ * @param record Pointer to a record from `piconfc_NDEF_iteratorNextChunked`.
+ * @param dest Pointer to the destination buffer, may be NULL if `destsize` is 0.
+ * @param destsize Size of the destination buffer in bytes.
+ * @return The total payload length. If it is larger than `destsize`, only `destsize` bytes were copied.
+ */
+uint32_t piconfc_NDEF_gatherPayload(const NDEFChunkedRecord *record, uint8_t *dest, uint32_t destsize);
+
+/**
+ * @brief Builds an NDEF message directly in its final tag image.
+ *
+ * Records are appended straight into a caller-provided buffer laid out as the tag data area
+ * written from page 4: the NDEF TLV header is reserved up front and filled in by
+ * `piconfc_NDEF_builderFinish`, which also appends the terminator and pads the image to whole
+ * pages. The builder does not allocate and copies each record field exactly once.
+ */
+typedef struct {
+    uint8_t * buffer;
+    int bufsize;
+    int header_len;   ///< Bytes reserved for the TLV tag and length (2 or 4)
+    int head;         ///< Offset where the next record is written
+    int last_record;  ///< Offset of the last record header, or -1 before the first record
+    int open_payload; ///< Offset of the payload of a record opened by piconfc_NDEF_builderOpenRecord, or -1
+    bool failed;      ///< Set when a record did not fit in the buffer
+} NDEFBuilder;
+
+/**
+ * @brief Prepares a builder over a tag image buffer.
+ *
+ * The size of the TLV length field is chosen from the buffer size: buffers that cannot hold a
+ * message of 255 bytes or more reserve the 1-byte form, larger buffers reserve the 3-byte form.
+ *
+ * @param builder Pointer to the builder to initialize.
+ * @param buffer Pointer to the image buffer. Its size should be a multiple of `NDEF_IMAGE_ALIGN`.
+ * @param bufsize Size of the image buffer in bytes.
+ */
+void piconfc_NDEF_builderInit(NDEFBuilder *builder, uint8_t *buffer, int bufsize);
+
+/**
+ * @brief Appends a record to the message being built.
+ *
+ * The record header is written with the SR flag for payloads shorter than 256 bytes, the IL flag
+ * when an ID is given, and the MB flag on the first record. The ME flag is set on the last record
+ * by `piconfc_NDEF_builderFinish`.
+ *
+ * @param builder Pointer to an initialized builder.
+ * @param tnf Type Name Format (TNF) for the NDEF record.
+ * @param type Pointer to the type field data.
+ * @param typelen Length of the type field data in bytes.
+ * @param id Pointer to the ID field data (optional).
+ * @param idlen Length of the ID field data in bytes (0 if not used).
+ * @param payload Pointer to the payload data.
+ * @param payloadlen Length of the payload data in bytes.
+ * @return True if the record was appended; false if it does not fit. A failed append makes
+ *         `piconfc_NDEF_builderFinish` fail as well.
+ */
+bool piconfc_NDEF_builderAddRecord(NDEFBuilder *builder, enum TNF tnf, uint8_t *type, uint8_t typelen, uint8_t *id, uint8_t idlen, uint8_t *payload, unsigned int payloadlen);
+
+/**
+ * @brief Opens a record whose payload is written in place by the caller.
+ *
+ * The record header, type and ID are written, and a pointer to where the payload goes is returned,
+ * so an encoder can write the payload straight into the tag image. The payload length is filled in
+ * by `piconfc_NDEF_builderCloseRecord`. No other record can be added while a record is open.
+ *
+ * @param builder Pointer to an initialized builder.
+ * @param tnf Type Name Format (TNF) for the NDEF record.
+ * @param type Pointer to the type field data.
+ * @param typelen Length of the type field data in bytes.
+ * @param id Pointer to the ID field data (optional).
+ * @param idlen Length of the ID field data in bytes (0 if not used).
+ * @param room Pointer to an int set to the largest payload that fits, in bytes.
+ * @return Pointer to the payload area; NULL if the header does not fit or a record is already open.
+ */
+uint8_t *piconfc_NDEF_builderOpenRecord(NDEFBuilder *builder, enum TNF tnf, uint8_t *type, uint8_t typelen, uint8_t *id, uint8_t idlen, int *room);
+
+/**
+ * @brief Closes the record opened by `piconfc_NDEF_builderOpenRecord`.
+ *
+ * Payloads shorter than 256 bytes are moved down by 3 bytes to use the short record form.
+ *
+ * @param builder Pointer to a builder with an open record.
+ * @param payloadlen Number of payload bytes written, at most the room returned on opening.
+ * @return True if the record was closed; false if no record is open or the payload is too long.
+ */
+bool piconfc_NDEF_builderCloseRecord(NDEFBuilder *builder, unsigned int payloadlen);
+
+/**
+ * @brief Appends a record split into chunked records (CF flag).
+ *
+ * The payload is written as chunks of at most `chunk_size` bytes. The first chunk carries the
+ * TNF, type and ID, the following chunks have TNF `TNF_UNCHANGED`, and every chunk but the last
+ * has the CF flag. Chunks of up to 255 bytes use the short record header. A payload no longer than
+ * `chunk_size` is written as a single unchunked record.
+ *
+ * @param builder Pointer to an initialized builder.
+ * @param tnf Type Name Format (TNF) for the NDEF record.
+ * @param type Pointer to the type field data.
+ * @param typelen Length of the type field data in bytes.
+ * @param id Pointer to the ID field data (optional).
+ * @param idlen Length of the ID field data in bytes (0 if not used).
+ * @param payload Pointer to the payload data.
+ * @param payloadlen Length of the payload data in bytes.
+ * @param chunk_size Largest payload of a single chunk in bytes, at least 1.
+ * @return True if all chunks were appended; false if they do not fit or `chunk_size` is 0.
+ */
+bool piconfc_NDEF_builderAddChunkedRecord(NDEFBuilder *builder, enum TNF tnf, uint8_t *type, uint8_t typelen, uint8_t *id, uint8_t idlen, uint8_t *payload, unsigned int payloadlen, unsigned int chunk_size);
+
+/**
+ * @brief Appends a well-known Text ('T') record encoded as UTF-8.
+ *
+ * The status byte, language code and text are written directly into the record payload.
+ *
+ * @param builder Pointer to an initialized builder.
+ * @param language Null-terminated IANA language code, at most 63 bytes (e.g., "en").
+ * @param text Null-terminated UTF-8 text.
+ * @return True if the record was appended; false if it does not fit or the language code is too long.
+ */
+bool piconfc_NDEF_builderAddText(NDEFBuilder *builder, const char *language, const char *text);
+
+/**
+ * @brief Finds the longest URI identifier code prefix of a URI.
+ *
+ * The 35 prefixes of the URI record type definition are grouped by their first letter in a
+ * precomputed table, longest first, so only the few prefixes sharing the URI's first letter
+ * are compared and the first match is the longest.
+ *
+ * @param uri Null-terminated URI.
+ * @param prefix_len Pointer to an int set to the length of the matched prefix (0 if none).
+ * @return The identifier code (one of the NDEF_URIPREFIX_* values), or `NDEF_URIPREFIX_NONE`.
+ */
+uint8_t piconfc_NDEF_uriPrefix(const char *uri, int *prefix_len);
+
+/**
+ * @brief Encodes a URI record payload with the longest matching prefix compressed.
+ *
+ * The payload is the identifier code from `piconfc_NDEF_uriPrefix` followed by the rest of the
+ * URI, ready to be used as the payload of a well-known 'U' record.
+ *
+ * @param uri Null-terminated URI.
+ * @param dest Pointer to the buffer receiving the payload.
+ * @param destsize Size of the destination buffer in bytes.
+ * @return The payload length in bytes; 0 if the destination buffer is too small.
+ */
+int piconfc_NDEF_encodeURIPayload(const char *uri, uint8_t *dest, int destsize);
+
+/**
+ * @brief Appends a well-known URI ('U') record with a compressed prefix.
+ *
+ * The identifier code and the remainder of the URI are written directly into the record
+ * payload in the image, without building the payload separately first.
+ *
+ * @param builder Pointer to an initialized builder.
+ * @param uri Null-terminated URI.
+ * @return True if the record was appended; false if it does not fit.
+ */
+bool piconfc_NDEF_builderAddURI(NDEFBuilder *builder, const char *uri);
+
+/**
+ * @brief Completes the tag image.
+ *
+ * Sets the ME flag on the last record, writes the TLV tag and length in front of the message,
+ * appends the terminator TLV and pads the image with zeros to a multiple of `NDEF_IMAGE_ALIGN`.
+ * If the 3-byte length form was reserved but the message is shorter than 255 bytes, the message
+ * is moved down by 2 bytes to use the 1-byte form. After finishing, the message starts at
+ * `builder->header_len`.
+ *
+ * @param builder Pointer to a builder with the records appended.
+ * @return The length of the padded image in bytes, ready for `piconfc_NTAG_writeNDEF`; 0 if a
+ *         record did not fit or the padded image does not fit in the buffer.
+ */
+int piconfc_NDEF_builderFinish(NDEFBuilder *builder);
+
 /**
  * @brief Parses an NDEF message from a buffer and loads an array of NDEF records.
  *
  * This function reads NDEF records from the provided buffer and stores them in a dynamically
  * allocated array of `NDEFRecord` structures. The caller is responsible for freeing this
- * array once done. The number of records parsed is returned by the function.
+ * array with `piconfc_NDEF_free` once done. The number of records parsed is returned by the function. The message is
+ * parsed in a single pass with an `NDEFIterator`; code that must not allocate should use the
+ * iterator directly.
  *
  * @param buffer Pointer to the buffer containing the NDEF message.
  * @param bufsize Size of the buffer in bytes.
  * @param dest Pointer to an `NDEFRecord*` that will be set to the dynamically allocated
- *             array of parsed records.
+ *             array of parsed records, or to NULL if no records were parsed.
  * @return The number of records parsed if successful; 0 if no records are found or in case of an error.
  */
 int piconfc_NDEF_parseMessage(uint8_t *buffer, int bufsize, NDEFRecord **dest);
@@ -157,7 +716,8 @@ int piconfc_NDEF_parseMessage(uint8_t *buffer, int bufsize, NDEFRecord **dest);
  * This function iterates through the buffer to count the number of NDEF records present.
  * It supports both short and standard length formats for the payload and handles records
  * with optional ID fields. The function stops when it reaches the end of the message or
- * the end of the buffer.
+ * the end of the buffer. Records are counted with an `NDEFIterator`, so only records that
+ * fit in the buffer are counted.
  *
  * @param buffer Pointer to the buffer containing the NDEF message.
  * @param bufsize Size of the buffer in bytes.
@@ -186,8 +746,10 @@ int piconfc_NDEF_parseRecord(uint8_t *buffer, int bufsize, int offset, NDEFRecor
  *
  * This function constructs an NDEF record with specified parameters, including the
  * Type Name Format (TNF), type field, ID field, and payload data. It dynamically allocates
- * memory for the record, which the caller is responsible for freeing. The function supports
+ * memory for the record, which the caller is responsible for freeing with `piconfc_NDEF_free`. The function supports
  * both short and standard length formats for the payload, and includes optional ID fields.
+ * The record has both the MB and ME flags set, so it is a complete single-record message.
+ * To build multi-record messages without allocating, use `NDEFBuilder`.
  *
  * @param dest Pointer to a buffer pointer where the created record will be stored.
  *             The caller is responsible for freeing this buffer.
@@ -203,17 +765,90 @@ int piconfc_NDEF_parseRecord(uint8_t *buffer, int bufsize, int offset, NDEFRecor
  */
 bool piconfc_NDEF_createRecord(uint8_t **dest, unsigned int *recordlen, enum TNF tnf, uint8_t *type, uint8_t typelen, uint8_t *id, uint8_t idlen, uint8_t *payload, unsigned int payloadlen);
 
+/**
+ * @brief Returns the type field of a record without copying it.
+ *
+ * @param record Pointer to a parsed record.
+ * @return A slice of the record buffer holding the type.
+ */
+NDEFSlice piconfc_NDEF_recordType(const NDEFRecord *record);
+
+/**
+ * @brief Returns the ID field of a record without copying it.
+ *
+ * @param record Pointer to a parsed record.
+ * @return A slice of the record buffer holding the ID; its length is 0 if the record has no ID.
+ */
+NDEFSlice piconfc_NDEF_recordId(const NDEFRecord *record);
+
+/**
+ * @brief Returns the payload of a record without copying it.
+ *
+ * @param record Pointer to a parsed record.
+ * @return A slice of the record buffer holding the raw payload.
+ */
+NDEFSlice piconfc_NDEF_recordPayload(const NDEFRecord *record);
+
+/**
+ * @brief Copies the MIME type of a record into a caller buffer.
+ *
+ * Works like `snprintf`: at most `destsize - 1` bytes are copied, `dest` is always null-terminated
+ * when `destsize` is not 0, and the full length is returned so truncation can be detected.
+ *
+ * @param record Pointer to the NDEFRecord structure containing the MIME type data.
+ * @param dest Pointer to the destination buffer, may be NULL if `destsize` is 0.
+ * @param destsize Size of the destination buffer in bytes.
+ * @return The length of the MIME type, excluding the null terminator; -1 if the record is not of MIME type.
+ */
+int piconfc_NDEF_copyMIMEString(const NDEFRecord *record, char *dest, int destsize);
+
+/**
+ * @brief Writes the payload string of a record to a sink in pieces.
+ *
+ * For a URI record, the expanded prefix (e.g., "http://") and the rest of the URI are passed to
+ * the sink as two consecutive pieces, so the URI is never concatenated in memory. A Text record
+ * is written as UTF-8 with `piconfc_NDEF_writeText`. Any other payload is passed as a single
+ * piece. Nothing is allocated. Compressed records (see piconfc_LZ.h) cannot be streamed because
+ * decoding refers back to earlier output; read them with `piconfc_NDEF_copyPayloadString`.
+ *
+ * @param record Pointer to the NDEFRecord structure containing the payload.
+ * @param sink Callback receiving the pieces in order.
+ * @param ctx Context pointer passed to the sink.
+ * @return The total length written to the sink; -1 if the record is a URI with an invalid prefix,
+ *         a malformed Text record or a compressed record.
+ */
+int piconfc_NDEF_writePayloadString(const NDEFRecord *record, NDEFSink sink, void *ctx);
+
+/**
+ * @brief Copies the payload string of a record into a caller buffer.
+ *
+ * The string is the same as the one from `piconfc_NDEF_readPayloadString`, with URI prefixes
+ * expanded, Text records decoded to UTF-8 and compressed records decompressed directly into
+ * `dest`. Truncated text never ends inside a character. Works like `snprintf`: at most `destsize - 1` bytes are copied, `dest` is always
+ * null-terminated when `destsize` is not 0, and the full length is returned, so calling it with
+ * `destsize = 0` measures the string.
+ *
+ * @param record Pointer to the NDEFRecord structure containing the payload.
+ * @param dest Pointer to the destination buffer, may be NULL if `destsize` is 0.
+ * @param destsize Size of the destination buffer in bytes.
+ * @return The length of the full string, excluding the null terminator; -1 if the record is a
+ *         URI with an invalid prefix, a malformed Text record or a malformed compressed record,
+ *         in which case `dest` holds an empty string.
+ */
+int piconfc_NDEF_copyPayloadString(const NDEFRecord *record, char *dest, int destsize);
+
 /**
  * @brief Reads a MIME type string from an NDEF record.
  *
  * This function extracts the MIME type string from an NDEF record if the Type Name Format (TNF)
  * is set to `TNF_MIME`. It allocates memory for the string and appends a null terminator.
- * The caller is responsible for freeing the allocated string once done.
+ * The caller is responsible for freeing the allocated string with `piconfc_NDEF_free` once done.
  *
  * @param record Pointer to the NDEFRecord structure containing the MIME type data.
  * @param string Pointer to a char pointer where the resulting MIME type string will be stored.
  *               The caller is responsible for freeing this string if the function succeeds.
  * @return True if the MIME type string was successfully read; false if the record is not of MIME type or if memory allocation fails.
+ * @note Use `piconfc_NDEF_copyMIMEString` to avoid the allocation.
  */
 bool piconfc_NDEF_readMIMEString(NDEFRecord *record, char **string);
 
@@ -223,14 +858,175 @@ bool piconfc_NDEF_readMIMEString(NDEFRecord *record, char **string);
  * This function extracts the URI payload from an NDEF record if the Type Name Format (TNF)
  * is set to `TNF_WELLKNOWN` and the type is `U`, indicating a URI with a prefix.
  * It dynamically allocates memory for the complete URI, appending the appropriate prefix
- * (e.g., "http://") if present. The caller is responsible for freeing the allocated string.
+ * (e.g., "http://") if present. The caller is responsible for freeing the allocated string
+ * with `piconfc_NDEF_free`.
  *
  * @param record Pointer to the NDEFRecord structure containing the URI data.
  * @param string Pointer to a char pointer where the resulting URI string will be stored.
  *               The caller is responsible for freeing this string if the function succeeds.
- * @return True if the URI payload string was successfully read; false if the record does
- *         not contain a URI or if memory allocation fails.
+ * @return True if the URI payload string was successfully read; false if the payload is malformed
+ *         (see `piconfc_NDEF_copyPayloadString`) or if memory allocation fails.
+ * @note Use `piconfc_NDEF_copyPayloadString` or `piconfc_NDEF_writePayloadString` to avoid the allocation.
  */
 bool piconfc_NDEF_readPayloadString(NDEFRecord *record, char **string);
 
+/**
+ * @brief Parses the status byte and language code of a Text ('T') record.
+ *
+ * @param record Pointer to a parsed record.
+ * @param text Pointer to an `NDEFText` to populate with slices into the record buffer.
+ * @return True if the record is a Text record whose language code fits in the payload; false otherwise.
+ */
+bool piconfc_NDEF_parseText(const NDEFRecord *record, NDEFText *text);
+
+/**
+ * @brief Writes the text of a Text record to a sink as UTF-8.
+ *
+ * UTF-8 text is validated with `piconfc_NDEF_validateUTF8` and passed through in one piece.
+ * UTF-16 text is transcoded in small batches. The whole text is validated before the sink is called.
+ *
+ * @param text Pointer to a parsed Text record.
+ * @param sink Callback receiving the UTF-8 pieces in order.
+ * @param ctx Context pointer passed to the sink.
+ * @return The UTF-8 length of the text; -1 if the text is not well-formed.
+ */
+int piconfc_NDEF_writeText(const NDEFText *text, NDEFSink sink, void *ctx);
+
+/**
+ * @brief Copies the text of a Text record into a caller buffer as UTF-8.
+ *
+ * Works like `snprintf`, except that truncation never splits a character.
+ *
+ * @param text Pointer to a parsed Text record.
+ * @param dest Pointer to the destination buffer, may be NULL if `destsize` is 0.
+ * @param destsize Size of the destination buffer in bytes.
+ * @return The full UTF-8 length of the text, excluding the null terminator; -1 if the text is not well-formed.
+ */
+int piconfc_NDEF_copyText(const NDEFText *text, char *dest, int destsize);
+
+/**
+ * @brief Checks that a buffer holds well-formed UTF-8.
+ *
+ * Runs of ASCII are checked a 32-bit word at a time. Overlong forms, surrogates, code points past
+ * U+10FFFF and truncated sequences are rejected.
+ *
+ * @param data Pointer to the text.
+ * @param len Length of the text in bytes.
+ * @return True if the text is well-formed UTF-8; false otherwise.
+ */
+bool piconfc_NDEF_validateUTF8(const uint8_t *data, int len);
+
+/**
+ * @brief Transcodes UTF-16 text into a caller buffer as UTF-8.
+ *
+ * The byte order is taken from a leading byte order mark, which is dropped, and is big endian
+ * without one. Works like `snprintf`, except that truncation never splits a character.
+ *
+ * @param data Pointer to the UTF-16 text.
+ * @param len Length of the text in bytes.
+ * @param dest Pointer to the destination buffer, may be NULL if `destsize` is 0.
+ * @param destsize Size of the destination buffer in bytes.
+ * @return The full UTF-8 length, excluding the null terminator; -1 if the UTF-16 is malformed
+ *         (odd length or unpaired surrogate).
+ */
+int piconfc_NDEF_utf16ToUTF8(const uint8_t *data, int len, char *dest, int destsize);
+
+/**
+ * @brief Reads the URI, title, action, size and type of a Smart Poster ('Sp') record.
+ *
+ * The embedded message is walked once with `piconfc_NDEF_iteratorDescend`, without allocating.
+ * The URI can then be read with `piconfc_NDEF_copyPayloadString` on `poster->uri` and the title
+ * with `piconfc_NDEF_copyText` on `poster->title`.
+ *
+ * @param parent Pointer to the iterator that produced the record, used for the depth limit.
+ * @param record Pointer to the Smart Poster record.
+ * @param poster Pointer to an `NDEFSmartPoster` to populate.
+ * @return True if the record is a Smart Poster with a URI record; false otherwise or if it is
+ *         nested too deeply.
+ */
+bool piconfc_NDEF_parseSmartPoster(const NDEFIterator *parent, const NDEFRecord *record, NDEFSmartPoster *poster);
+
+/**
+ * @brief Prepares an empty dispatcher.
+ *
+ * @param dispatcher Pointer to the dispatcher to initialize.
+ */
+void piconfc_NDEF_dispatcherInit(NDEFDispatcher *dispatcher);
+
+/**
+ * @brief Registers a handler for records of a TNF and type.
+ *
+ * Types are compared byte for byte, so MIME types must be registered in the case they appear in
+ * on tags. Registering a pair that is already registered replaces its handler.
+ *
+ * @param dispatcher Pointer to an initialized dispatcher.
+ * @param tnf Type Name Format of the records to handle.
+ * @param type Pointer to the type, e.g. "text/plain" or "example.com:t". Not copied.
+ * @param typelen Length of the type in bytes.
+ * @param handler Callback to invoke for matching records.
+ * @param ctx Context pointer passed to the handler.
+ * @return True if the handler was registered; false if the handler is NULL or the dispatcher
+ *         already holds `NDEF_DISPATCH_MAX_HANDLERS` handlers.
+ */
+bool piconfc_NDEF_dispatcherRegister(NDEFDispatcher *dispatcher, enum TNF tnf, const uint8_t *type, uint8_t typelen, NDEFHandler handler, void *ctx);
+
+/**
+ * @brief Finds the handler registered for a record's TNF and type.
+ *
+ * @param dispatcher Pointer to an initialized dispatcher.
+ * @param record Pointer to a parsed record.
+ * @return Pointer to the matching entry, or NULL if none is registered.
+ */
+const NDEFDispatchEntry *piconfc_NDEF_dispatcherLookup(NDEFDispatcher *dispatcher, const NDEFRecord *record);
+
+/**
+ * @brief Walks an NDEF message once and invokes the handler of each record with a registered type.
+ *
+ * Records are parsed in place with an `NDEFIterator` and passed to handlers as zero-copy views.
+ * Records without a registered handler are skipped.
+ *
+ * @param dispatcher Pointer to an initialized dispatcher.
+ * @param buffer Pointer to the buffer containing the NDEF message, e.g. `TLV.value_ptr`.
+ * @param bufsize Size of the message in bytes.
+ * @return The number of records handed to a handler.
+ */
+int piconfc_NDEF_dispatch(NDEFDispatcher *dispatcher, uint8_t *buffer, int bufsize);
+
+/**
+ * @brief Indexes the records of an NDEF message by type and ID in a single pass.
+ *
+ * When several records share a type or ID, the first one is indexed. If a message has more than
+ * `NDEF_INDEX_MAX_RECORDS` distinct types or IDs, the rest are not indexed and lookups that miss
+ * walk the message instead, so results stay correct.
+ *
+ * @param index Pointer to the index to build.
+ * @param buffer Pointer to the buffer containing the NDEF message, e.g. `TLV.value_ptr`.
+ * @param bufsize Size of the message in bytes.
+ * @return The number of records in the message.
+ */
+int piconfc_NDEF_indexBuild(NDEFIndex *index, uint8_t *buffer, int bufsize);
+
+/**
+ * @brief Finds the first record of a TNF and type.
+ *
+ * @param index Pointer to a built index.
+ * @param tnf Type Name Format of the record.
+ * @param type Pointer to the type.
+ * @param typelen Length of the type in bytes.
+ * @param record Pointer to an `NDEFRecord` to populate with the record found.
+ * @return True if a record was found; false otherwise.
+ */
+bool piconfc_NDEF_indexFindType(NDEFIndex *index, enum TNF tnf, const uint8_t *type, uint8_t typelen, NDEFRecord *record);
+
+/**
+ * @brief Finds the first record with an ID.
+ *
+ * @param index Pointer to a built index.
+ * @param id Pointer to the ID.
+ * @param idlen Length of the ID in bytes.
+ * @param record Pointer to an `NDEFRecord` to populate with the record found.
+ * @return True if a record was found; false otherwise.
+ */
+bool piconfc_NDEF_indexFindId(NDEFIndex *index, const uint8_t *id, uint8_t idlen, NDEFRecord *record);
+
 #endif /* NDEF_H */
\ No newline at end of file
@@ -11,13 +11,29 @@
 #ifndef NTAG_H
 #define NTAG_H
 
-#include "piconfc.h"
-
 /**
  * @brief The size of an NTAG page in bytes.
  */
 #define NTAG_PAGE_SIZE (0x04) // Bytes
 
+/**
+ * @brief The first user-writable page on NTAG21X tags.
+ */
+#define NTAG_USER_START_PAGE (0x04)
+
+/**
+ * @brief The largest user memory of the supported tags in bytes (NTAG216).
+ */
+#define NTAG_MAX_USER_BYTES (888)
+
+/**
+ * @brief How many times a page that fails write verification is rewritten before giving up.
+ */
+#define NTAG_WRITE_RETRIES (2)
+
+// Included after the size constants, which piconfc.h uses in its own structures
+#include "piconfc.h"
+
 /**
  * @enum NTAG21X
  * @brief Enumeration for the supported NTAG models.
@@ -44,10 +60,23 @@ enum NTAG21X {
  *
  * @param config Pointer to the PicoNFCConfig structure containing configuration details.
  * @return Enum value of type NTAG21X indicating the tag model (NTAG213, NTAG215, or NTAG216),
- *         or 0 if the read operation fails.
+ *         or 0 if the read operation fails. Other tags return their own capability container
+ *         size byte, for which `piconfc_NTAG_userPageEnd` returns 0.
  */
 enum NTAG21X piconfc_NTAG_getModel(PicoNFCConfig *config);
 
+/**
+ * @brief Returns the user page limit for an NTAG model.
+ *
+ * The returned page is exclusive: user pages run from `NTAG_USER_START_PAGE` up to, but not
+ * including, the returned page (0x28, 0x82 and 0xE2, for 144, 504 and 888 bytes of user memory).
+ * This is the same limit used by `piconfc_NTAG_readUserPages` and `piconfc_NTAG_writeUserData`.
+ *
+ * @param model The NTAG model as returned by `piconfc_NTAG_getModel`.
+ * @return The exclusive end page for the model, or 0 if the model is unknown.
+ */
+uint8_t piconfc_NTAG_userPageEnd(enum NTAG21X model);
+
 /**
  * @brief Reads a single 4-byte page from the NTAG tag into the provided buffer.
  *
@@ -111,19 +140,80 @@ int piconfc_NTAG_readUserPages(PicoNFCConfig *config, uint8_t *buffer, unsigned
  */
 bool piconfc_NTAG_writePage(PicoNFCConfig *config, uint8_t page, uint8_t *buffer);
 
+/**
+ * @brief Writes a run of consecutive pages to the NTAG.
+ *
+ * This function writes `npages` pages starting at `startpage`, taking 4 bytes per page from
+ * `buffer`. Unlike `piconfc_NTAG_writeUserData` it does not read the tag model and does not
+ * touch any page past the run, so only the pages that actually carry data are written.
+ *
+ * If `config->verify_writes` is set, the run is written in groups of 4 pages. After each group a
+ * single READ returns those 4 pages, which are compared with the buffer. Only the pages that do not
+ * match are rewritten, up to `NTAG_WRITE_RETRIES` times, and the group is read again after each retry.
+ * This costs one READ per 4 writes instead of one per page.
+ *
+ * @param config Pointer to the `PicoNFCConfig` structure containing I2C and buffer information.
+ * @param startpage First page to write.
+ * @param buffer Pointer to the data to write. Must hold at least `npages * NTAG_PAGE_SIZE` bytes.
+ * @param npages Number of pages to write.
+ * @return True if every page was written (and verified, if enabled) successfully; false on the first
+ *         failed write or on a page that still mismatches after all retries.
+ */
+bool piconfc_NTAG_writePages(PicoNFCConfig *config, uint8_t startpage, uint8_t *buffer, int npages);
+
 /**
  * @brief Writes data from the buffer to the NTAG user pages, up to the buffer size or the max NTAG page limit.
  *
  * This function replaces the contents of the NTAG user pages starting from page 4 with the data provided in the buffer.
  * It iterates through each page, writing 4 bytes at a time, until it reaches the end of the buffer or the NTAG's maximum
  * user page limit, based on the detected NTAG model (NTAG213, NTAG215, or NTAG216). The function stops and returns false
- * if the buffer size is insufficient to write a full 4-byte page at any iteration.
+ * if the buffer size is insufficient to write a full 4-byte page at any iteration. Pages are written with
+ * `piconfc_NTAG_writePages`, so they are verified when `config->verify_writes` is set. The buffer's TLVs are
+ * walked with `piconfc_NDEF_walkTLV`: bytes in areas announced by Lock Control or Memory Control TLVs keep
+ * their current contents on the tag, and an NDEF TLV is written with the safe update sequence of
+ * `piconfc_NTAG_writeNDEF`.
  *
  * @param config Pointer to the `PicoNFCConfig` structure containing I2C and buffer information.
  * @param buffer Pointer to the data buffer to write to the NTAG user pages.
  * @param bufsize Size of the data buffer in bytes.
- * @return True if the entire buffer was written to the NTAG; false if there was insufficient data or a write error.
+ * @return True if the entire buffer was written to the NTAG; false if there was insufficient data, a write
+ *         error, or the capability container names a tag that is not an NTAG21x, which is left untouched.
  */
 bool piconfc_NTAG_writeUserData(PicoNFCConfig *config, uint8_t * buffer, unsigned int bufsize);
 
+/**
+ * @brief Writes an NDEF TLV image to the tag using the NFC Forum safe update sequence.
+ *
+ * The image is a tag data area written from page 4, such as the output of `piconfc_NDEF_encodeTLV`.
+ * Its NDEF TLV is located with `piconfc_NDEF_walkTLV`. The page holding the TLV length is first
+ * rewritten as an empty NDEF TLV (length 0), then the remaining pages are written, and finally the
+ * length page is written with the real length. If the tag leaves the field at any point, it holds
+ * either the old message, an empty message, or the complete new message, but never a length pointing
+ * at half-written data. Pages reserved by Lock Control or Memory Control TLVs in the image are not
+ * overwritten. An interrupted write can be completed with `piconfc_NTAG_recoverNDEF`.
+ *
+ * @param config Pointer to the `PicoNFCConfig` structure containing I2C and buffer information.
+ * @param image Pointer to the TLV image to write.
+ * @param len Length of the image in bytes. Must be a multiple of `NTAG_PAGE_SIZE`.
+ * @return True if the whole image was written; false if the length is invalid or a write failed.
+ */
+bool piconfc_NTAG_writeNDEF(PicoNFCConfig *config, uint8_t *image, int len);
+
+/**
+ * @brief Completes an interrupted `piconfc_NTAG_writeNDEF` by writing only the missing pages.
+ *
+ * The pages covered by the image are read from the tag 4 at a time and compared with the image,
+ * ignoring reserved bytes. If they all match, nothing is written. If only the page holding the NDEF
+ * length differs (the final length write was lost), only that page is written. Otherwise the safe
+ * update sequence is resumed: the length page is set to an empty NDEF TLV unless it already is one,
+ * the mismatched pages are written, and the length page is written last.
+ *
+ * @param config Pointer to the `PicoNFCConfig` structure containing I2C and buffer information.
+ * @param image Pointer to the TLV image that was being written.
+ * @param len Length of the image in bytes. Must be a multiple of `NTAG_PAGE_SIZE`.
+ * @return The number of page writes issued (0 if the tag already held the image), or -1 if the
+ *         length is invalid or a read or write failed.
+ */
+int piconfc_NTAG_recoverNDEF(PicoNFCConfig *config, uint8_t *image, int len);
+
 #endif /* NTAG_H */
\ No newline at end of file
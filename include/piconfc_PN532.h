@@ -1,6 +1,6 @@
 /**
  * @file piconfc_PN532.h
- * @brief Header file for interfacing with the PN532 NFC module via I2C.
+ * @brief Header file for interfacing with the PN532 NFC module via I2C, SPI or HSU.
  *
  * This file contains constants, macros, and function declarations for configuring
  * and interacting with the PN532 NFC module. It provides commands for performing
@@ -8,7 +8,8 @@
  * unique IDs from NFC tags.
  *
  * The functions defined in this header file enable communication with the PN532
- * over I2C, allowing initialization, command sending, and response parsing. Only I2C is supported.
+ * over I2C, SPI or HSU, allowing initialization, command sending, and response parsing. The interface
+ * is the transport in the configuration; see `piconfc_I2C.h`, `piconfc_SPI.h` and `piconfc_HSU.h`.
  */
 
 #ifndef PN532_H
@@ -16,17 +17,10 @@
 
 #include "hardware/i2c.h"
 #include "piconfc.h"
+#include "piconfc_FRAME.h" // Frame bytes (preamble, start codes, TFI)
 
 // PN532 Specific Definitions
 
-#define PN532_PREAMBLE (0x00)   ///< Command sequence start, byte 1/3
-#define PN532_STARTCODE1 (0x00) ///< Command sequence start, byte 2/3
-#define PN532_STARTCODE2 (0xFF) ///< Command sequence start, byte 3/3
-#define PN532_POSTAMBLE (0x00)  ///< EOD
-
-#define PN532_HOSTTOPN532 (0xD4) ///< Host-to-PN532
-#define PN532_PN532TOHOST (0xD5) ///< PN532-to-host
-
 // PN532 Commands
 #define PN532_COMMAND_DIAGNOSE (0x00)              ///< Diagnose
 #define PN532_COMMAND_GETFIRMWAREVERSION (0x02)    ///< Get firmware version
@@ -72,6 +66,11 @@
 #define PN532_I2C_READY (0x01)        ///< Ready
 #define PN532_I2C_READYTIMEOUT (20)   ///< Ready timeout
 
+#define PN532_SPI_STATREAD (0x02)  ///< Status read
+#define PN532_SPI_DATAWRITE (0x01) ///< Data write
+#define PN532_SPI_DATAREAD (0x03)  ///< Data read
+#define PN532_SPI_READY (0x01)     ///< Ready
+
 #define PN532_BAUD_ISO14443A (0x00) ///< Most common card rate in the US
 #define PN532_BAUD_ISO14443B (0x03)
 
@@ -143,6 +142,19 @@ bool piconfc_PN532_SAMConfiguration(PicoNFCConfig *config);
  */
 bool piconfc_PN532_setPassiveActivationRetries(PicoNFCConfig *config, uint8_t retries);
 
+/**
+ * @brief Changes the rate of the PN532 side of its serial (HSU) interface.
+ *
+ * This function sends the Set Serial Baud Rate command and, once the PN532 has confirmed it,
+ * acknowledges the response, which is what makes the PN532 switch. The host side must switch right
+ * after, with `piconfc_HSU_setBaudRate`; `piconfc_initHSU` does both.
+ *
+ * @param config Pointer to the `PicoNFCConfig` structure containing the transport and buffer information.
+ * @param baudrate New rate in baud: 9600, 19200, 38400, 57600, 115200, 230400, 460800 or 921600.
+ * @return True if the PN532 confirmed the change; false for an unsupported rate or a communication error.
+ */
+bool piconfc_PN532_setSerialBaudRate(PicoNFCConfig *config, uint32_t baudrate);
+
 /**
  * @brief Waits for an NFC card to enter the detection field and reads its unique ID (UID).
  *
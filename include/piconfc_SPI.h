@@ -0,0 +1,59 @@
+/**
+ * @file piconfc_SPI.h
+ * @brief SPI backend for interfacing with the PN532 NFC module.
+ *
+ * The PN532 takes SPI at up to 5 MHz, more than ten times the I2C rate, which matters for bulk
+ * reads where bus time is a large share of each command. Every transaction starts with an operation
+ * byte (status read, data write or data read) while chip select is held low, and the PN532 shifts
+ * bytes least significant bit first. The RP2040 SPI only shifts most significant bit first, so this
+ * backend reverses the bits of every byte in software.
+ *
+ * Frames and the command sequence are shared with I2C through the transport in `piconfc_I2C.h`:
+ * set one up with `piconfc_SPI_init` and `piconfc_SPI_transport`, or use `piconfc_initSPI`.
+ */
+
+#ifndef PICONFC_SPI_H
+#define PICONFC_SPI_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "hardware/spi.h"
+#include "piconfc_I2C.h"
+
+#define PICONFC_SPI_FREQ (5 * 1000 * 1000)
+
+/**
+ * @brief A PN532 on a Pico SPI block, with its own chip select pin.
+ */
+typedef struct {
+    spi_inst_t *block;  // SPI instance the PN532 is on
+    uint8_t cs_pin;     // GPIO pin driving the PN532 chip select (NSS), active low
+} PicoNFCSPIBus;
+
+/**
+ * @brief Initializes the SPI bus and pins for a PN532 and wakes it up.
+ *
+ * This function initializes the SPI instance at `PICONFC_SPI_FREQ` in mode 0, configures the clock
+ * and data pins for SPI, and drives chip select as a GPIO. The PN532 wakes up on the falling edge
+ * of chip select, so it is pulsed low for 2 ms before the first command.
+ *
+ * @param bus Pointer to the bus to initialize.
+ * @param block Pointer to the SPI instance to initialize (e.g., spi0 or spi1).
+ * @param sck_pin GPIO pin to use for the SCK (clock) line.
+ * @param mosi_pin GPIO pin to use for the MOSI (host to PN532) line.
+ * @param miso_pin GPIO pin to use for the MISO (PN532 to host) line.
+ * @param cs_pin GPIO pin to use for chip select.
+ */
+void piconfc_SPI_init(PicoNFCSPIBus *bus, spi_inst_t *block, uint8_t sck_pin, uint8_t mosi_pin, uint8_t miso_pin, uint8_t cs_pin);
+
+/**
+ * @brief Sets up a transport that reaches the PN532 on a Pico SPI block.
+ *
+ * Readiness is the status read operation, polled every millisecond.
+ *
+ * @param transport Pointer to the transport to set up.
+ * @param bus Pointer to the bus, initialized with `piconfc_SPI_init`, which must outlive the transport.
+ */
+void piconfc_SPI_transport(PicoNFCTransport *transport, PicoNFCSPIBus *bus);
+
+#endif /* PICONFC_SPI_H */
@@ -1,45 +1,173 @@
 #include "pico/stdlib.h"
 #include <stdlib.h>
+#include <string.h>
 #include "piconfc.h"
 #include "piconfc_I2C.h"
+#include "piconfc_SPI.h"
+#include "piconfc_HSU.h"
 
 bool piconfc_init(PicoNFCConfig *empty_config, i2c_inst_t *i2c_block, int sda_pin, int scl_pin) {
     empty_config->i2c_block = i2c_block;                 // Set the I2C instance in the config structure
+    empty_config->verify_writes = false;                 // Write verification is opt-in
     piconfc_I2C_init(i2c_block, sda_pin, scl_pin);       // Initialize I2C with specified pins
+    piconfc_I2C_transport(&empty_config->transport, i2c_block); // Reach the PN532 over that block
     return piconfc_PN532_SAMConfiguration(empty_config); // Configure the NFC module's SAM
 }
 
-bool piconfc_readNTAG(PicoNFCConfig *config, int timeout_ms, char **string_ptr) {
-    uint8_t uid[7] = { 0 };
-    uint8_t uid_len = 0;
+bool piconfc_initSPI(PicoNFCConfig *empty_config, spi_inst_t *spi_block, int sck_pin, int mosi_pin, int miso_pin, int cs_pin) {
+    empty_config->i2c_block = NULL;                      // No Pico I2C block behind this transport
+    empty_config->verify_writes = false;                 // Write verification is opt-in
+    piconfc_SPI_init(&empty_config->spi_bus, spi_block, sck_pin, mosi_pin, miso_pin, cs_pin); // Initialize SPI and wake the PN532
+    piconfc_SPI_transport(&empty_config->transport, &empty_config->spi_bus); // Reach the PN532 over that bus
+    return piconfc_PN532_SAMConfiguration(empty_config); // Configure the NFC module's SAM
+}
+
+bool piconfc_initHSU(PicoNFCConfig *empty_config, uart_inst_t *uart_block, int tx_pin, int rx_pin, uint32_t baudrate) {
+    empty_config->i2c_block = NULL;                      // No Pico I2C block behind this transport
+    empty_config->verify_writes = false;                 // Write verification is opt-in
+    piconfc_HSU_init(&empty_config->hsu_bus, uart_block, tx_pin, rx_pin); // Initialize the UART at the PN532's starting rate
+    piconfc_HSU_transport(&empty_config->transport, &empty_config->hsu_bus); // Reach the PN532 over that UART
+
+    // The first command wakes the PN532, and SAMConfiguration must be that command
+    if (!piconfc_PN532_SAMConfiguration(empty_config)) return false;
+    if (baudrate == PICONFC_HSU_BAUD) return true;
+
+    // Switch the PN532, then the host side to match
+    if (!piconfc_PN532_setSerialBaudRate(empty_config, baudrate)) return false;
+    piconfc_HSU_setBaudRate(&empty_config->hsu_bus, baudrate);
+    return true;
+}
+
+bool piconfc_initTransport(PicoNFCConfig *empty_config, const PicoNFCTransport *transport) {
+    empty_config->i2c_block = NULL;                      // No Pico I2C block behind this transport
+    empty_config->transport = *transport;                // Copy the backend's operations and state
+    empty_config->verify_writes = false;                 // Write verification is opt-in
+    return piconfc_PN532_SAMConfiguration(empty_config); // Configure the NFC module's SAM
+}
+
+// Checks whether a record is the one a read was asked to stop at
+static bool piconfc_matchesStop(const NDEFRecord *record, const PicoNFCReadOptions *options) {
+    if (options->type == NULL) return true; // Any record
+    return record->tnf == options->tnf && record->type_length == options->type_length &&
+           memcmp(record->buffer + record->type_offset, options->type, options->type_length) == 0;
+}
+
+// Parses the records of the (possibly partial) message into the tag; returns true if the stop record was found
+static bool piconfc_collectRecords(PicoNFCTag *tag, const PicoNFCReadOptions *options) {
+    NDEFIterator it;
+    NDEFRecord record;
+
+    tag->record_count = 0;
+    piconfc_NDEF_iteratorInit(&it, (uint8_t *)tag->message.ptr, tag->message.len);
+    while (piconfc_NDEF_iteratorNext(&it, &record)) {
+        if (tag->record_count < PICONFC_MAX_RECORDS) tag->records[tag->record_count++] = record;
+        if (options != NULL && piconfc_matchesStop(&record, options)) return true;
+    }
+    return false;
+}
+
+bool piconfc_readTag(PicoNFCConfig *config, int timeout_ms, uint8_t *buffer, int bufsize, const PicoNFCReadOptions *options, PicoNFCTag *tag) {
+    uint8_t block[16];
+
+    tag->data = buffer;
+    tag->data_len = 0;
+    tag->reads = 0;
+    tag->message.ptr = NULL;
+    tag->message.len = 0;
+    tag->record_count = 0;
+    tag->complete = false;
 
     // Attempt to detect an NFC tag within range
-    bool found = piconfc_PN532_readPassiveTargetID(config, PN532_BAUD_ISO14443A, uid, &uid_len, timeout_ms);
-    if (!found) return false;
+    if (!piconfc_PN532_readPassiveTargetID(config, PN532_BAUD_ISO14443A, tag->uid, &tag->uid_len, timeout_ms)) return false;
 
-    static uint8_t readbuf[888];
-    // Read user pages from the detected tag into a static buffer
-    int memlen = piconfc_NTAG_readUserPages(config, readbuf, sizeof(readbuf));
-    if (memlen == 0) return false;
-
-    struct TLV tlv;
-    // Parse the TLV structure from the data read
-    bool valid = piconfc_NDEF_parseTLV(&tlv, readbuf, memlen, 0);
-    if (!valid) return false;
-
-    NDEFRecord *records = NULL;
-    // Parse the NDEF message into individual records
-    int num_records = piconfc_NDEF_parseMessage(tlv.value_ptr, tlv.value_length, &records);
-    if (num_records < 1) {
-        free(records); // Free records array if parsing failed
-        return false;
+    // Page 3 holds the capability container, followed by the first 12 bytes of the data area
+    if (!piconfc_NTAG_read4Pages(config, 0x03, block)) return false;
+    tag->reads++;
+    memcpy(tag->cc, block, 4);
+    tag->model = tag->cc[2];
+
+    // Limit the read to the user memory, or to the data area size in the capability container
+    int end_page = piconfc_NTAG_userPageEnd(tag->model);
+    int data_size = end_page != 0 ? (end_page - NTAG_USER_START_PAGE) * NTAG_PAGE_SIZE : tag->cc[2] * 8;
+    if (data_size > bufsize) data_size = bufsize;
+    if (tag->cc[0] != 0xE1) return true; // Not formatted for NDEF
+
+    int head = 12 < data_size ? 12 : data_size;
+    memcpy(buffer, block + 4, head);
+
+    struct TLVMap map;
+    while (true) {
+        // Stop once the NDEF TLV is complete, or a terminator shows there is none
+        piconfc_NDEF_walkTLV(&map, buffer, head, 0);
+        if (map.ndef_block != -1) {
+            struct TLVBlock *ndef = &map.blocks[map.ndef_block];
+            tag->message.ptr = buffer + ndef->value_offset;
+            tag->message.len = ndef->value_length;
+            tag->complete = true;
+            break;
+        }
+        if (map.terminated) break;
+
+        // With a partial NDEF TLV, stop as soon as the requested record has been read
+        int stop = map.stop_offset;
+        if (options != NULL && stop + 2 <= head && buffer[stop] == NDEF_TLV_NDEF) {
+            int value_offset = buffer[stop + 1] == 0xFF ? stop + 4 : stop + 2;
+            if (value_offset <= head) {
+                tag->message.ptr = buffer + value_offset;
+                tag->message.len = head - value_offset;
+                if (piconfc_collectRecords(tag, options)) {
+                    tag->data_len = head;
+                    return true;
+                }
+            }
+        }
+        if (head >= data_size) break; // Out of user memory or buffer
+
+        // Read the next 4 pages, through a temporary block if they would overflow the buffer
+        int page = NTAG_USER_START_PAGE + head / NTAG_PAGE_SIZE;
+        int n = data_size - head < 16 ? data_size - head : 16;
+        uint8_t *dest = n == 16 ? buffer + head : block;
+        if (!piconfc_NTAG_read4Pages(config, page, dest)) break;
+        tag->reads++;
+        if (dest == block) memcpy(buffer + head, block, n);
+        head += n;
+    }
+
+    tag->data_len = head;
+    if (tag->message.ptr != NULL && !tag->complete) {
+        tag->message.len = 0; // A partial message without the stop record is not returned
     }
+    piconfc_collectRecords(tag, options);
+    return true;
+}
+
+// Reads the tag in the field and parses the first record of its NDEF message in place
+static bool piconfc_readFirstRecord(PicoNFCConfig *config, int timeout_ms, NDEFRecord *record) {
+    static uint8_t readbuf[888];
+    static PicoNFCTag tag;
+    PicoNFCReadOptions first = { TNF_EMPTY, NULL, 0 };
+
+    // Read only as far as the first record
+    if (!piconfc_readTag(config, timeout_ms, readbuf, sizeof(readbuf), &first, &tag)) return false;
+    if (tag.record_count == 0) return false;
+    *record = tag.records[0];
+    return true;
+}
+
+bool piconfc_readNTAG(PicoNFCConfig *config, int timeout_ms, char **string_ptr) {
+    NDEFRecord record;
+    if (!piconfc_readFirstRecord(config, timeout_ms, &record)) return false;
 
     // Read the payload of the first NDEF record into the output string
-    bool success = piconfc_NDEF_readPayloadString(&records[0], string_ptr);
-    free(records); // Free the records array after use
+    return piconfc_NDEF_readPayloadString(&record, string_ptr);
+}
 
-    return success;
+int piconfc_readNTAGString(PicoNFCConfig *config, int timeout_ms, char *dest, int destsize) {
+    NDEFRecord record;
+    if (!piconfc_readFirstRecord(config, timeout_ms, &record)) return -1;
+
+    // Copy the payload of the first NDEF record into the caller's buffer
+    return piconfc_NDEF_copyPayloadString(&record, dest, destsize);
 }
 
 bool piconfc_tagPresent(PicoNFCConfig *config, int delay_ms) {
@@ -48,3 +176,153 @@ bool piconfc_tagPresent(PicoNFCConfig *config, int delay_ms) {
     // Attempt to read the UID of a tag within range using the specified configuration
     return piconfc_PN532_readPassiveTargetID(config, PN532_BAUD_ISO14443A, uid, &uid_len, delay_ms);
 }
+
+bool piconfc_provisionPrepare(PicoNFCProvisionJob *job, enum TNF tnf, uint8_t *type, uint8_t typelen, uint8_t *payload, unsigned int payloadlen) {
+    NDEFBuilder builder;
+
+    // Encode the template record once, straight into the page image
+    piconfc_NDEF_builderInit(&builder, job->image, sizeof(job->image));
+    if (!piconfc_NDEF_builderAddRecord(&builder, tnf, type, typelen, NULL, 0, payload, payloadlen))
+        return false;
+    int payload_in_message = builder.head - payloadlen - builder.header_len;
+
+    // Finishing may shorten the TLV header, so locate the payload afterwards
+    job->image_len = piconfc_NDEF_builderFinish(&builder);
+    if (job->image_len == 0) return false;
+    job->payload_offset = builder.header_len + payload_in_message;
+    job->payload_length = payloadlen;
+
+    // Images that fit an NTAG213 fit every supported model, so the model read can be skipped
+    int smallest = (piconfc_NTAG_userPageEnd(MODEL_NTAG213) - NTAG_USER_START_PAGE) * NTAG_PAGE_SIZE;
+    job->check_model = job->image_len > smallest;
+
+    job->last_uid_len = 0;
+    job->tags_written = 0;
+    job->tags_failed = 0;
+    job->start_ms = to_ms_since_boot(get_absolute_time());
+    return true;
+}
+
+bool piconfc_provisionSetField(PicoNFCProvisionJob *job, int offset, const uint8_t *data, int len) {
+    // Templated fields must stay inside the payload so the record headers remain valid
+    if (offset < 0 || len < 0 || offset + len > job->payload_length) return false;
+    memcpy(job->image + job->payload_offset + offset, data, len);
+    return true;
+}
+
+bool piconfc_provisionNext(PicoNFCConfig *config, PicoNFCProvisionJob *job, int timeout_ms) {
+    uint8_t uid[7] = { 0 };
+    uint8_t uid_len = 0;
+
+    // Wait for a tag to enter the field
+    bool found = piconfc_PN532_readPassiveTargetID(config, PN532_BAUD_ISO14443A, uid, &uid_len, timeout_ms);
+    if (!found) return false;
+
+    // Ignore the tag that was just provisioned if it is still in the field
+    if (uid_len == job->last_uid_len && memcmp(uid, job->last_uid, uid_len) == 0) return false;
+
+    // Only large images need to know that the tag can hold them
+    if (job->check_model) {
+        uint8_t end_userpages = piconfc_NTAG_userPageEnd(piconfc_NTAG_getModel(config));
+        if (NTAG_USER_START_PAGE + job->image_len / NTAG_PAGE_SIZE > end_userpages) {
+            job->tags_failed++;
+            return false;
+        }
+    }
+
+    // Write only the pages covered by the image, verifying every group of 4 pages
+    int npages = job->image_len / NTAG_PAGE_SIZE;
+    bool verify_writes = config->verify_writes;
+    config->verify_writes = true;
+
+    // Factory and used tags already hold a TLV at page 4, so unless it is an empty NDEF TLV
+    // the tag is first made to advertise an empty message while the body is written
+    uint8_t current[16];
+    bool success = piconfc_NTAG_read4Pages(config, NTAG_USER_START_PAGE, current);
+    if (success && npages > 1 && (current[0] != NDEF_TLV_NDEF || current[1] != 0x00)) {
+        uint8_t empty[NTAG_PAGE_SIZE];
+        memcpy(empty, job->image, NTAG_PAGE_SIZE);
+        empty[1] = 0x00;
+        empty[2] = NDEF_TLV_TERMINATOR;
+        success = piconfc_NTAG_writePages(config, NTAG_USER_START_PAGE, empty, 1);
+    }
+
+    // Publish the message by writing the header page last
+    if (success) success = piconfc_NTAG_writePages(config, NTAG_USER_START_PAGE + 1, job->image + NTAG_PAGE_SIZE, npages - 1);
+    if (success) success = piconfc_NTAG_writePages(config, NTAG_USER_START_PAGE, job->image, 1);
+    config->verify_writes = verify_writes;
+    if (!success) {
+        job->tags_failed++;
+        return false;
+    }
+
+    memcpy(job->last_uid, uid, uid_len);
+    job->last_uid_len = uid_len;
+    job->tags_written++;
+    return true;
+}
+
+int piconfc_writeMessage(PicoNFCConfig *config, int timeout_ms, uint8_t *image, int len) {
+    uint8_t uid[7] = { 0 };
+    uint8_t uid_len = 0;
+    if (len <= 0 || len % NTAG_PAGE_SIZE != 0 || len > NTAG_MAX_USER_BYTES) return -1;
+
+    // Wait for a tag to enter the field
+    if (!piconfc_PN532_readPassiveTargetID(config, PN532_BAUD_ISO14443A, uid, &uid_len, timeout_ms)) return -1;
+
+    // Images that fit an NTAG213 fit every supported model, so the model read can be skipped
+    int smallest = (piconfc_NTAG_userPageEnd(MODEL_NTAG213) - NTAG_USER_START_PAGE) * NTAG_PAGE_SIZE;
+    if (len > smallest) {
+        uint8_t end_userpages = piconfc_NTAG_userPageEnd(piconfc_NTAG_getModel(config));
+        if (NTAG_USER_START_PAGE + len / NTAG_PAGE_SIZE > end_userpages) return -1;
+    }
+
+    // Diff against the tag and write only the pages that differ, length page last
+    return piconfc_NTAG_recoverNDEF(config, image, len);
+}
+
+static uint8_t writebuf[NTAG_MAX_USER_BYTES]; // Image buffer shared by the typed write functions
+
+// Finishes a single-record image and writes it, if the record was added
+static int piconfc_writeRecord(PicoNFCConfig *config, int timeout_ms, NDEFBuilder *builder, bool added) {
+    if (!added) return -1;
+    int len = piconfc_NDEF_builderFinish(builder);
+    if (len == 0) return -1;
+    return piconfc_writeMessage(config, timeout_ms, builder->buffer, len);
+}
+
+int piconfc_writeURI(PicoNFCConfig *config, int timeout_ms, const char *uri) {
+    NDEFBuilder builder;
+    piconfc_NDEF_builderInit(&builder, writebuf, sizeof(writebuf));
+    return piconfc_writeRecord(config, timeout_ms, &builder, piconfc_NDEF_builderAddURI(&builder, uri));
+}
+
+int piconfc_writeText(PicoNFCConfig *config, int timeout_ms, const char *language, const char *text) {
+    NDEFBuilder builder;
+    piconfc_NDEF_builderInit(&builder, writebuf, sizeof(writebuf));
+    return piconfc_writeRecord(config, timeout_ms, &builder, piconfc_NDEF_builderAddText(&builder, language, text));
+}
+
+int piconfc_writeMIME(PicoNFCConfig *config, int timeout_ms, const char *mime, const uint8_t *data, int len) {
+    NDEFBuilder builder;
+    size_t typelen = strlen(mime);
+    if (typelen > 0xFF || len < 0) return -1;
+    piconfc_NDEF_builderInit(&builder, writebuf, sizeof(writebuf));
+    bool added = piconfc_NDEF_builderAddRecord(&builder, TNF_MIME, (uint8_t *)mime, typelen, NULL, 0, (uint8_t *)data, len);
+    return piconfc_writeRecord(config, timeout_ms, &builder, added);
+}
+
+int piconfc_writeExternal(PicoNFCConfig *config, int timeout_ms, const char *type, const uint8_t *data, int len) {
+    NDEFBuilder builder;
+    size_t typelen = strlen(type);
+    if (typelen > 0xFF || len < 0) return -1;
+    piconfc_NDEF_builderInit(&builder, writebuf, sizeof(writebuf));
+    bool added = piconfc_NDEF_builderAddRecord(&builder, TNF_EXTERNAL, (uint8_t *)type, typelen, NULL, 0, (uint8_t *)data, len);
+    return piconfc_writeRecord(config, timeout_ms, &builder, added);
+}
+
+float piconfc_provisionRate(PicoNFCProvisionJob *job) {
+    uint32_t elapsed_ms = to_ms_since_boot(get_absolute_time()) - job->start_ms;
+    if (elapsed_ms == 0) return 0;
+    return job->tags_written * 60000.0f / elapsed_ms; // Tags per minute
+}
@@ -0,0 +1,328 @@
+#include <string.h>
+
+#include "piconfc_CBOR.h"
+#include "piconfc_NDEF.h"
+
+// Major types in the top 3 bits of an initial byte
+#define CBOR_MAJOR_UINT (0)
+#define CBOR_MAJOR_NEGINT (1)
+#define CBOR_MAJOR_BYTES (2)
+#define CBOR_MAJOR_TEXT (3)
+#define CBOR_MAJOR_ARRAY (4)
+#define CBOR_MAJOR_MAP (5)
+#define CBOR_MAJOR_TAG (6)
+#define CBOR_MAJOR_SIMPLE (7)
+
+// Additional information values with a special meaning
+#define CBOR_INFO_UINT8 (24)
+#define CBOR_INFO_HALF (25)
+#define CBOR_INFO_SINGLE (26)
+#define CBOR_INFO_DOUBLE (27)
+#define CBOR_INFO_INDEFINITE (31)
+
+// Marks the reader as failed and reports no item
+static bool cbor_fail(CBORReader *reader) {
+    reader->error = true;
+    return false;
+}
+
+// Converts IEEE 754 half precision bits to a float
+static float cbor_halfToFloat(uint16_t half) {
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+    uint32_t bits;
+
+    if (exponent == 0 && mantissa == 0) {
+        bits = sign; // Zero
+    } else if (exponent == 0) {
+        // Subnormal halves are normal floats; shift the mantissa until its leading 1 is implicit
+        exponent = 127 - 15 + 1;
+        while (!(mantissa & 0x400)) {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | exponent << 23 | (mantissa & 0x3FF) << 13;
+    } else if (exponent == 31) {
+        bits = sign | 0x7F800000 | mantissa << 13; // Infinity or NaN
+    } else {
+        bits = sign | (exponent + 127 - 15) << 23 | mantissa << 13;
+    }
+
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void piconfc_CBOR_readerInit(CBORReader *reader, const uint8_t *buffer, int len) {
+    reader->buffer = buffer;
+    reader->len = len;
+    reader->offset = 0;
+    reader->error = false;
+}
+
+bool piconfc_CBOR_readerInitRecord(CBORReader *reader, const NDEFRecord *record) {
+    int typelen = sizeof(CBOR_EXTERNAL_TYPE) - 1;
+    if (record->tnf != TNF_EXTERNAL || record->type_length != typelen || memcmp(record->buffer + record->type_offset, CBOR_EXTERNAL_TYPE, typelen) != 0)
+        return false;
+    piconfc_CBOR_readerInit(reader, record->buffer + record->data_offset, record->data_length);
+    return true;
+}
+
+bool piconfc_CBOR_next(CBORReader *reader, CBORValue *value) {
+    if (reader->error || reader->offset >= reader->len) return false;
+
+    const uint8_t *buffer = reader->buffer;
+    uint8_t initial = buffer[reader->offset++];
+    uint8_t major = initial >> 5;
+    uint8_t info = initial & 0x1F;
+    int remaining = reader->len - reader->offset;
+
+    // Decode the argument, which follows the initial byte in 1, 2, 4 or 8 bytes for info 24 to 27
+    uint64_t argument = info;
+    bool indefinite = false;
+    if (info >= CBOR_INFO_UINT8 && info <= CBOR_INFO_DOUBLE) {
+        int n = 1 << (info - CBOR_INFO_UINT8);
+        if (n > remaining) return cbor_fail(reader);
+        argument = 0;
+        for (int i = 0; i < n; i++) argument = argument << 8 | buffer[reader->offset + i];
+        reader->offset += n;
+        remaining -= n;
+    } else if (info == CBOR_INFO_INDEFINITE) {
+        // Only arrays, maps and the break code may be indefinite
+        if (major != CBOR_MAJOR_ARRAY && major != CBOR_MAJOR_MAP && major != CBOR_MAJOR_SIMPLE) return cbor_fail(reader);
+        indefinite = true;
+    } else if (info > CBOR_INFO_DOUBLE) {
+        return cbor_fail(reader); // Reserved values
+    }
+
+    switch (major) {
+        case CBOR_MAJOR_UINT:
+            value->type = CBOR_TYPE_UINT;
+            value->uint = argument;
+            break;
+        case CBOR_MAJOR_NEGINT:
+            if (argument > INT64_MAX) return cbor_fail(reader); // Does not fit an int64_t
+            value->type = CBOR_TYPE_NEGINT;
+            value->sint = -1 - (int64_t)argument;
+            break;
+        case CBOR_MAJOR_BYTES:
+        case CBOR_MAJOR_TEXT:
+            // Strings are returned as views, so they must lie entirely in the buffer
+            if (argument > (uint64_t)remaining) return cbor_fail(reader);
+            value->type = major == CBOR_MAJOR_TEXT ? CBOR_TYPE_TEXT : CBOR_TYPE_BYTES;
+            value->string.ptr = buffer + reader->offset;
+            value->string.len = (int)argument;
+            reader->offset += (int)argument;
+            break;
+        case CBOR_MAJOR_ARRAY:
+        case CBOR_MAJOR_MAP:
+            // Every item takes at least one byte, which bounds any sane count by the bytes left
+            if (!indefinite && argument > (uint64_t)remaining) return cbor_fail(reader);
+            value->type = major == CBOR_MAJOR_MAP ? CBOR_TYPE_MAP : CBOR_TYPE_ARRAY;
+            value->count = indefinite ? CBOR_INDEFINITE : (uint32_t)argument;
+            break;
+        case CBOR_MAJOR_TAG:
+            value->type = CBOR_TYPE_TAG;
+            value->uint = argument;
+            break;
+        default:
+            if (indefinite) {
+                value->type = CBOR_TYPE_BREAK;
+            } else if (info == 20 || info == 21) {
+                value->type = CBOR_TYPE_BOOL;
+                value->boolean = info == 21;
+            } else if (info == 22) {
+                value->type = CBOR_TYPE_NULL;
+            } else if (info == 23) {
+                value->type = CBOR_TYPE_UNDEFINED;
+            } else if (info == CBOR_INFO_HALF) {
+                value->type = CBOR_TYPE_FLOAT;
+                value->number = cbor_halfToFloat((uint16_t)argument);
+            } else if (info == CBOR_INFO_SINGLE) {
+                uint32_t bits = (uint32_t)argument;
+                float single;
+                memcpy(&single, &bits, sizeof(single));
+                value->type = CBOR_TYPE_FLOAT;
+                value->number = single;
+            } else if (info == CBOR_INFO_DOUBLE) {
+                value->type = CBOR_TYPE_FLOAT;
+                memcpy(&value->number, &argument, sizeof(value->number));
+            } else {
+                value->type = CBOR_TYPE_SIMPLE;
+                value->uint = argument;
+            }
+            break;
+    }
+    return true;
+}
+
+bool piconfc_CBOR_skip(CBORReader *reader) {
+    uint32_t remaining[CBOR_MAX_DEPTH]; // Items left at each nesting level, or CBOR_INDEFINITE
+    int depth = 0;
+    CBORValue value;
+
+    // Running out of input is only an error inside an item
+    if (reader->error || reader->offset >= reader->len) return false;
+
+    remaining[0] = 1;
+    while (depth >= 0) {
+        if (remaining[depth] == 0) {
+            depth--;
+            continue;
+        }
+        if (!piconfc_CBOR_next(reader, &value)) return cbor_fail(reader);
+
+        // A break ends the innermost indefinite container
+        if (value.type == CBOR_TYPE_BREAK) {
+            if (depth == 0 || remaining[depth] != CBOR_INDEFINITE) return cbor_fail(reader);
+            depth--;
+            continue;
+        }
+        if (remaining[depth] != CBOR_INDEFINITE) remaining[depth]--;
+
+        // Containers and tags are followed by the items nested in them
+        uint32_t nested = 0;
+        if (value.type == CBOR_TYPE_ARRAY) nested = value.count;
+        else if (value.type == CBOR_TYPE_MAP) nested = value.count == CBOR_INDEFINITE ? CBOR_INDEFINITE : value.count * 2;
+        else if (value.type == CBOR_TYPE_TAG) nested = 1;
+        if (nested != 0) {
+            if (depth + 1 == CBOR_MAX_DEPTH) return cbor_fail(reader);
+            remaining[++depth] = nested;
+        }
+    }
+    return true;
+}
+
+bool piconfc_CBOR_mapFind(CBORReader *reader, uint32_t count, const char *key, CBORValue *value) {
+    int keylen = strlen(key);
+    CBORValue current;
+
+    for (uint32_t i = 0; count == CBOR_INDEFINITE || i < count; i++) {
+        int start = reader->offset;
+        if (!piconfc_CBOR_next(reader, &current) || current.type == CBOR_TYPE_BREAK) return false;
+
+        // Compare text keys in place; the value is only decoded on a match
+        if (current.type == CBOR_TYPE_TEXT && current.string.len == keylen && memcmp(current.string.ptr, key, keylen) == 0)
+            return piconfc_CBOR_next(reader, value);
+
+        // Rewind over the key, which may itself be nested, and skip the pair
+        reader->offset = start;
+        if (!piconfc_CBOR_skip(reader) || !piconfc_CBOR_skip(reader)) return false;
+    }
+    return false;
+}
+
+void piconfc_CBOR_writerInit(CBORWriter *writer, uint8_t *buffer, int bufsize) {
+    writer->buffer = buffer;
+    writer->bufsize = bufsize;
+    writer->head = 0;
+    writer->failed = false;
+}
+
+// Writes an initial byte and its argument in the shortest form
+static bool cbor_writeHead(CBORWriter *writer, uint8_t major, uint64_t argument) {
+    int n = argument < 24 ? 0 : argument <= 0xFF ? 1 : argument <= 0xFFFF ? 2 : argument <= 0xFFFFFFFF ? 4 : 8;
+    if (writer->failed || writer->head + 1 + n > writer->bufsize) {
+        writer->failed = true;
+        return false;
+    }
+
+    uint8_t *out = writer->buffer + writer->head;
+    out[0] = major << 5 | (n == 0 ? argument : n == 1 ? 24 : n == 2 ? 25 : n == 4 ? 26 : 27);
+    for (int i = 0; i < n; i++) out[1 + i] = argument >> (8 * (n - 1 - i));
+    writer->head += 1 + n;
+    return true;
+}
+
+// Writes a string header followed by its bytes
+static bool cbor_writeString(CBORWriter *writer, uint8_t major, const void *data, int len) {
+    if (!cbor_writeHead(writer, major, len)) return false;
+    if (writer->head + len > writer->bufsize) {
+        writer->failed = true;
+        return false;
+    }
+    memcpy(writer->buffer + writer->head, data, len);
+    writer->head += len;
+    return true;
+}
+
+bool piconfc_CBOR_writeUint(CBORWriter *writer, uint64_t value) {
+    return cbor_writeHead(writer, CBOR_MAJOR_UINT, value);
+}
+
+bool piconfc_CBOR_writeInt(CBORWriter *writer, int64_t value) {
+    // Negative integers are stored as -1 - n
+    if (value < 0) return cbor_writeHead(writer, CBOR_MAJOR_NEGINT, (uint64_t)(-1 - value));
+    return cbor_writeHead(writer, CBOR_MAJOR_UINT, value);
+}
+
+bool piconfc_CBOR_writeBytes(CBORWriter *writer, const uint8_t *data, int len) {
+    return cbor_writeString(writer, CBOR_MAJOR_BYTES, data, len);
+}
+
+bool piconfc_CBOR_writeText(CBORWriter *writer, const char *text, int len) {
+    return cbor_writeString(writer, CBOR_MAJOR_TEXT, text, len);
+}
+
+bool piconfc_CBOR_writeArray(CBORWriter *writer, uint32_t count) {
+    return cbor_writeHead(writer, CBOR_MAJOR_ARRAY, count);
+}
+
+bool piconfc_CBOR_writeMap(CBORWriter *writer, uint32_t count) {
+    return cbor_writeHead(writer, CBOR_MAJOR_MAP, count);
+}
+
+bool piconfc_CBOR_writeTag(CBORWriter *writer, uint64_t tag) {
+    return cbor_writeHead(writer, CBOR_MAJOR_TAG, tag);
+}
+
+bool piconfc_CBOR_writeBool(CBORWriter *writer, bool value) {
+    return cbor_writeHead(writer, CBOR_MAJOR_SIMPLE, value ? 21 : 20);
+}
+
+bool piconfc_CBOR_writeNull(CBORWriter *writer) {
+    return cbor_writeHead(writer, CBOR_MAJOR_SIMPLE, 22);
+}
+
+bool piconfc_CBOR_writeFloat(CBORWriter *writer, float value) {
+    // Simple values 24 and up take an argument byte, so floats are written by hand
+    if (writer->failed || writer->head + 5 > writer->bufsize) {
+        writer->failed = true;
+        return false;
+    }
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint8_t *out = writer->buffer + writer->head;
+    out[0] = CBOR_MAJOR_SIMPLE << 5 | CBOR_INFO_SINGLE;
+    for (int i = 0; i < 4; i++) out[1 + i] = bits >> (8 * (3 - i));
+    writer->head += 5;
+    return true;
+}
+
+int piconfc_CBOR_writerLength(const CBORWriter *writer) {
+    return writer->failed ? -1 : writer->head;
+}
+
+bool piconfc_CBOR_builderOpen(NDEFBuilder *builder, CBORWriter *writer) {
+    int room;
+    uint8_t *payload = piconfc_NDEF_builderOpenRecord(builder, TNF_EXTERNAL, (uint8_t *)CBOR_EXTERNAL_TYPE, sizeof(CBOR_EXTERNAL_TYPE) - 1, NULL, 0, &room);
+    if (payload == NULL) {
+        piconfc_CBOR_writerInit(writer, NULL, 0);
+        writer->failed = true;
+        return false;
+    }
+    piconfc_CBOR_writerInit(writer, payload, room);
+    return true;
+}
+
+bool piconfc_CBOR_builderClose(NDEFBuilder *builder, CBORWriter *writer) {
+    int len = piconfc_CBOR_writerLength(writer);
+    if (len < 0) {
+        // Close the record so the builder is consistent, but fail the whole message
+        piconfc_NDEF_builderCloseRecord(builder, 0);
+        builder->failed = true;
+        return false;
+    }
+    return piconfc_NDEF_builderCloseRecord(builder, len);
+}
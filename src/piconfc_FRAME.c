@@ -0,0 +1,94 @@
+#include "piconfc_FRAME.h"
+
+#ifdef I2C_DEBUG
+    #include <stdio.h>
+#endif
+
+int piconfc_FRAME_build(const uint8_t *cmd, uint8_t cmdlen, uint8_t *frame, int framesize) {
+    // LEN counts the TFI as well, and must fit in a single byte
+    if (cmdlen > 0xFE || cmdlen + PN532_FRAME_OVERHEAD > framesize) return 0;
+    uint8_t data_len = cmdlen + 1;
+
+    // Construct the packet header
+    frame[0] = PN532_PREAMBLE;
+    frame[1] = PN532_STARTCODE1;
+    frame[2] = PN532_STARTCODE2;
+    frame[3] = data_len;                     // Data length (command length + 1)
+    frame[4] = ~data_len + 1;                // Length checksum, must sum to 0x00
+    frame[5] = PN532_HOSTTOPN532;            // Direction byte (Host to PN532)
+
+    uint8_t checksum_val = 0;
+
+    // Copy command data and calculate checksum
+    for (int i = 0; i < cmdlen; i++) {
+        frame[6 + i] = cmd[i];
+        checksum_val += cmd[i];
+    }
+
+    // Finalize the packet with data checksum and postamble
+    frame[6 + cmdlen] = ~(PN532_HOSTTOPN532 + checksum_val) + 1; // Checksum for direction and data
+    frame[7 + cmdlen] = PN532_POSTAMBLE; // Postamble byte
+    return cmdlen + PN532_FRAME_OVERHEAD;
+}
+
+int piconfc_FRAME_check(uint8_t *buffer, int len) {
+    // Validate the preamble and start codes
+    if (len < 6 || buffer[0] != PN532_PREAMBLE || buffer[1] != PN532_STARTCODE1 || buffer[2] != PN532_STARTCODE2) {
+        #ifdef I2C_DEBUG
+            printf("Validate failed Preamble check!\n");
+        #endif
+        return -1;
+    }
+
+    // Validate length and length checksum
+    uint8_t datalen = buffer[3];
+    uint8_t checksum = datalen + buffer[4];
+    if (checksum != 0 || datalen == 0 || 6 + datalen > len) {
+        #ifdef I2C_DEBUG
+            printf("Validate failed length checksum!\n");
+        #endif
+        return -1;
+    }
+
+    // Validate data direction and calculate data checksum
+    uint8_t direction = buffer[5];
+    uint8_t sum = 0 + direction;
+    for (int i = 1; i < datalen; i++) {
+        buffer[i - 1] = buffer[5 + i];
+        sum += buffer[5 + i];
+    }
+    sum += buffer[5 + datalen];
+    if (sum != 0) {
+        #ifdef I2C_DEBUG
+            printf("Validate failed data checksum!\n");
+        #endif
+        return -1;
+    }
+
+    // Return the length of the data, excluding the PN532 indicator
+    return datalen - 1;
+}
+
+int piconfc_FRAME_find(const uint8_t *buffer, int len, int *start) {
+    int i = 0;
+    for (; i + 1 < len; i++) {
+        // Start codes, then LEN and LCS once they have arrived
+        if (buffer[i] != PN532_STARTCODE1 || buffer[i + 1] != PN532_STARTCODE2) continue;
+        if (i + 3 >= len) break;
+        uint8_t datalen = buffer[i + 2];
+        uint8_t lcs = buffer[i + 3];
+
+        // ACK (00 FF) and NACK (FF 00) carry no data, only the postamble
+        int total;
+        if ((datalen == 0x00 && lcs == 0xFF) || (datalen == 0xFF && lcs == 0x00)) total = 5;
+        else if ((uint8_t)(datalen + lcs) == 0 && datalen > 0) total = datalen + 6; // Start codes, LEN, LCS, data, DCS, postamble
+        else continue; // Not a frame after all, such as a 00 FF inside noise
+
+        *start = i;
+        return i + total <= len ? total : 0;
+    }
+
+    // Keep a trailing start code byte, which may be completed by the next bytes
+    *start = i < len && buffer[i] == PN532_STARTCODE1 ? i : len;
+    return 0;
+}
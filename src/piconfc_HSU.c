@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <string.h>
+#include "hardware/uart.h"
+#include "pico/stdlib.h"
+
+#include "piconfc_HSU.h"
+#include "piconfc_PN532.h"
+#include "piconfc_FRAME.h"
+
+// Wake-up preamble: 0x55 wakes the PN532, the zeros give it time before the first frame
+static const uint8_t HSU_WAKEUP[] = {
+    PN532_WAKEUP, PN532_WAKEUP, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+// Drops the first count bytes of the receive buffer
+static void hsubus_consume(PicoNFCHSUBus *bus, int count) {
+    memmove(bus->rx, bus->rx + count, bus->rx_len - count);
+    bus->rx_len -= count;
+}
+
+// Moves received bytes into the buffer and checks whether a complete frame is at its start
+static bool hsubus_poll(PicoNFCHSUBus *bus) {
+    if (bus->frame_len > 0) return true;
+
+    // Take whatever the UART has received, up to a buffer full
+    while (bus->rx_len < PICONFC_HSU_BUFSIZE && uart_is_readable(bus->block)) {
+        bus->rx[bus->rx_len++] = uart_getc(bus->block);
+    }
+
+    int start;
+    int len = piconfc_FRAME_find(bus->rx, bus->rx_len, &start);
+
+    // A full buffer without a frame holds a false start code that can never complete
+    if (len == 0 && start == 0 && bus->rx_len == PICONFC_HSU_BUFSIZE) start = 1;
+
+    // Drop wake-up bytes, noise and anything else before the frame
+    if (start > 0) hsubus_consume(bus, start);
+    bus->frame_len = len;
+
+    #ifdef HSU_DEBUG
+        if (len > 0) {
+            printf("hsu frame: ");
+            printhex(bus->rx, len);
+        }
+    #endif
+    return len > 0;
+}
+
+// HSU backend of the transport seam; ctx is the PicoNFCHSUBus
+static bool hsubus_isready(PicoNFCTransport *transport) {
+    return hsubus_poll(transport->ctx);
+}
+
+static bool hsubus_write(PicoNFCTransport *transport, const uint8_t *data, int len) {
+    PicoNFCHSUBus *bus = transport->ctx;
+
+    // Anything still unread belongs to an earlier command, which this one aborts
+    while (uart_is_readable(bus->block)) uart_getc(bus->block);
+    bus->rx_len = 0;
+    bus->frame_len = 0;
+
+    // The PN532 ignores frames until it has been woken up
+    if (!bus->awake) {
+        uart_write_blocking(bus->block, HSU_WAKEUP, sizeof(HSU_WAKEUP));
+        bus->awake = true;
+    }
+    uart_write_blocking(bus->block, data, len);
+    return true;
+}
+
+static bool hsubus_read(PicoNFCTransport *transport, uint8_t *data, int len) {
+    PicoNFCHSUBus *bus = transport->ctx;
+    if (!hsubus_poll(bus)) return false;
+
+    // Put a preamble back in front, so the frame reads as it does over I2C and SPI
+    int copy = bus->frame_len < len - 1 ? bus->frame_len : len - 1;
+    memset(data, 0, len);
+    data[0] = PN532_PREAMBLE;
+    memcpy(data + 1, bus->rx, copy);
+
+    // The whole frame is consumed, however much of it was asked for
+    hsubus_consume(bus, bus->frame_len);
+    bus->frame_len = 0;
+    return true;
+}
+
+static bool hsubus_waitready(PicoNFCTransport *transport, int timeout_ms) {
+    PicoNFCHSUBus *bus = transport->ctx;
+    uint32_t start = to_ms_since_boot(get_absolute_time());
+
+    while (!hsubus_poll(bus)) {
+        uint32_t waited = to_ms_since_boot(get_absolute_time()) - start;
+        if (timeout_ms != 0 && waited >= (uint32_t)timeout_ms) {
+            #ifdef HSU_DEBUG
+                printf("TIMEOUT after %u ms\n", (unsigned)waited);
+            #endif
+            return false;
+        }
+        // Sleep until the next byte arrives instead of a fixed interval
+        uart_is_readable_within_us(bus->block, timeout_ms != 0 ? (timeout_ms - waited) * 1000 : 1000000);
+    }
+    return true;
+}
+
+void piconfc_HSU_init(PicoNFCHSUBus *bus, uart_inst_t *block, uint8_t tx_pin, uint8_t rx_pin) {
+    bus->block = block;
+    bus->awake = false;
+    bus->rx_len = 0;
+    bus->frame_len = 0;
+
+    // Initialize the UART at the rate the PN532 starts at, 8N1
+    bus->baudrate = uart_init(block, PICONFC_HSU_BAUD);
+
+    // Configure TX and RX pins for UART functionality
+    gpio_set_function(tx_pin, GPIO_FUNC_UART);
+    gpio_set_function(rx_pin, GPIO_FUNC_UART);
+}
+
+void piconfc_HSU_transport(PicoNFCTransport *transport, PicoNFCHSUBus *bus) {
+    transport->isready = hsubus_isready;
+    transport->write = hsubus_write;
+    transport->read = hsubus_read;
+    transport->waitready = hsubus_waitready;
+    transport->ctx = bus;
+}
+
+void piconfc_HSU_setBaudRate(PicoNFCHSUBus *bus, uint32_t baudrate) {
+    // Let the last bytes out at the old rate before switching
+    uart_tx_wait_blocking(bus->block);
+    bus->baudrate = uart_set_baudrate(bus->block, baudrate);
+    bus->rx_len = 0;
+    bus->frame_len = 0;
+}
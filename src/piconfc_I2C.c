@@ -5,8 +5,47 @@
 
 #include "piconfc_I2C.h"
 #include "piconfc_PN532.h"
+#include "piconfc_FRAME.h"
 
-const uint8_t PN532_ACK[] = {0, 0, 0xFF, 0, 0xFF, 0};
+const uint8_t PN532_ACK[6] = {0, 0, 0xFF, 0, 0xFF, 0};
+
+// Pico I2C backend of the transport seam; ctx is the i2c_inst_t
+static bool i2cbus_isready(PicoNFCTransport *transport) {
+    uint8_t rdy;
+    // Read one byte from the PN532 to check if it's ready
+    i2c_read_blocking(transport->ctx, PN532_I2C_ADDRESS, &rdy, 1, false);
+
+    // Return true if the byte matches the ready indicator
+    return rdy == PN532_I2C_READY;
+}
+
+static bool i2cbus_write(PicoNFCTransport *transport, const uint8_t *data, int len) {
+    return i2c_write_blocking(transport->ctx, PN532_I2C_ADDRESS, data, len, false) == len;
+}
+
+static bool i2cbus_read(PicoNFCTransport *transport, uint8_t *data, int len) {
+    uint8_t rbuff[len + 1]; // +1 for leading RDY byte
+
+    // Read len + 1 bytes from PN532 (first byte is RDY, remaining are data)
+    int n = i2c_read_blocking(transport->ctx, PN532_I2C_ADDRESS, rbuff, len + 1, true);
+
+    // Copy data from rbuff, skipping the first byte
+    memcpy(data, rbuff + 1, len);
+
+    #ifdef I2C_DEBUG
+        printf("readdata: ");
+        printhex(rbuff, len + 1);
+    #endif
+    return n == len + 1;
+}
+
+void piconfc_I2C_transport(PicoNFCTransport *transport, i2c_inst_t *block) {
+    transport->isready = i2cbus_isready;
+    transport->write = i2cbus_write;
+    transport->read = i2cbus_read;
+    transport->waitready = NULL; // Poll the status byte every millisecond
+    transport->ctx = block;
+}
 
 void piconfc_I2C_init(i2c_inst_t *block, uint8_t sda_pin, uint8_t scl_pin) {
     // Initialize the I2C instance with the specified frequency
@@ -21,20 +60,18 @@ void piconfc_I2C_init(i2c_inst_t *block, uint8_t sda_pin, uint8_t scl_pin) {
     gpio_pull_up(scl_pin);
 }
 
-bool piconfc_I2C_isready(i2c_inst_t* block) {
-    uint8_t rdy;
-    // Read one byte from the PN532 to check if it's ready
-    i2c_read_blocking(block, PN532_I2C_ADDRESS, &rdy, 1, false);
-    
-    // Return true if the byte matches the ready indicator
-    return rdy == PN532_I2C_READY;
+bool piconfc_I2C_isready(PicoNFCTransport *transport) {
+    return transport->isready(transport);
 }
 
-bool piconfc_I2C_waitready(i2c_inst_t* block, int timeout) {
+bool piconfc_I2C_waitready(PicoNFCTransport *transport, int timeout) {
     int timer = 0;
 
+    // Backends that can wait for readiness more precisely do so themselves
+    if (transport->waitready != NULL) return transport->waitready(transport, timeout);
+
     // Loop until PN532 is ready or the timeout is reached
-    while (!piconfc_I2C_isready(block)) {
+    while (!piconfc_I2C_isready(transport)) {
         // Check if a timeout is specified
         if (timeout != 0) {
             timer += 1;
@@ -52,19 +89,19 @@ bool piconfc_I2C_waitready(i2c_inst_t* block, int timeout) {
     return true;
 }
 
-bool piconfc_I2C_sendcommand_andack(i2c_inst_t* block, uint8_t * cmd, uint8_t len, int timeout) {
+bool piconfc_I2C_sendcommand_andack(PicoNFCTransport *transport, uint8_t * cmd, uint8_t len, int timeout) {
 
     // Send command packet to the PN532
-    piconfc_I2C_writecommand(block, cmd, len);
+    piconfc_I2C_writecommand(transport, cmd, len);
 
     // Wait for the device to be ready before reading the ACK
-    if (!piconfc_I2C_waitready(block, timeout)) return false;
+    if (!piconfc_I2C_waitready(transport, timeout)) return false;
 
     // Brief delay to allow the device to process the command
     sleep_ms(1);
 
     // Check if the ACK was received
-    if (!piconfc_I2C_readack(block)) {
+    if (!piconfc_I2C_readack(transport)) {
         return false;
     }
 
@@ -72,110 +109,52 @@ bool piconfc_I2C_sendcommand_andack(i2c_inst_t* block, uint8_t * cmd, uint8_t le
     sleep_ms(1);
 
     // Wait for the device to be ready again after the ACK
-    if (!piconfc_I2C_waitready(block, timeout)) {
+    if (!piconfc_I2C_waitready(transport, timeout)) {
         return false;
     }
 
     return true;
 }
 
-bool piconfc_I2C_readack(i2c_inst_t* block) {
+bool piconfc_I2C_readack(PicoNFCTransport *transport) {
     uint8_t ackbuf[sizeof(PN532_ACK)];
     
     // Read data into ackbuf and check if it matches the ACK pattern
-    piconfc_I2C_readdata(block, ackbuf, sizeof(ackbuf));
+    if (!piconfc_I2C_readdata(transport, ackbuf, sizeof(ackbuf))) return false;
     return (memcmp((char *)ackbuf, (char *)PN532_ACK, sizeof(PN532_ACK)) == 0);
 }
 
-void piconfc_I2C_readdata(i2c_inst_t* block, uint8_t * buffer, uint8_t len) {
-    uint8_t rbuff[len + 1]; // +1 for leading RDY byte
-
-    // Read len + 1 bytes from PN532 (first byte is RDY, remaining are data)
-    i2c_read_blocking(block, PN532_I2C_ADDRESS, rbuff, len + 1, true);
-
-    // Copy data from rbuff, skipping the first byte
-    for (uint8_t i = 0; i < len; i++) {
-        buffer[i] = rbuff[i + 1];
-    }
-
-    #ifdef I2C_DEBUG
-        printf("readdata: ");
-        printhex(rbuff, len + 1);
-    #endif
+bool piconfc_I2C_readdata(PicoNFCTransport *transport, uint8_t * buffer, uint8_t len) {
+    // The backend drops any status byte that precedes the frame
+    return transport->read(transport, buffer, len);
 }
 
-void piconfc_I2C_writecommand(i2c_inst_t* block, uint8_t * cmd, uint8_t cmdlen) {
-    uint8_t packet[8 + cmdlen];
-    uint8_t data_len = cmdlen + 1;
-
-    // Construct the packet header
-    packet[0] = PN532_PREAMBLE;
-    packet[1] = PN532_STARTCODE1;
-    packet[2] = PN532_STARTCODE2;
-    packet[3] = data_len;                     // Data length (command length + 1)
-    packet[4] = ~data_len + 1;                // Length checksum, must sum to 0x00
-    packet[5] = PN532_HOSTTOPN532;            // Direction byte (Host to PN532)
-
-    uint8_t checksum_val = 0;
-
-    // Copy command data and calculate checksum
-    for (int i = 0; i < cmdlen; i++) {
-        packet[6 + i] = cmd[i];
-        checksum_val += cmd[i];
-    }
+void piconfc_I2C_writecommand(PicoNFCTransport *transport, uint8_t * cmd, uint8_t cmdlen) {
+    uint8_t packet[PN532_FRAME_OVERHEAD + cmdlen];
 
-    // Finalize the packet with data checksum and postamble
-    packet[6 + cmdlen] = ~(PN532_HOSTTOPN532 + checksum_val) + 1; // Checksum for direction and data
-    packet[7 + cmdlen] = PN532_POSTAMBLE; // Postamble byte
+    // Wrap the command in a normal information frame
+    int len = piconfc_FRAME_build(cmd, cmdlen, packet, sizeof(packet));
+    if (len == 0) return;
 
-    // Send the packet over I2C
-    i2c_write_blocking(block, PN532_I2C_ADDRESS, packet, 8 + cmdlen, false);
+    // Send the packet over the transport
+    transport->write(transport, packet, len);
 
     #ifdef I2C_DEBUG
         printf("wrote: ");
-        printhex(packet, 8 + cmdlen);
+        printhex(packet, len);
     #endif
 }
 
-uint8_t piconfc_I2C_parseresponse(i2c_inst_t *block, uint8_t *buffer, uint8_t expected_data_len) {
+uint8_t piconfc_I2C_parseresponse(PicoNFCTransport *transport, uint8_t *buffer, uint8_t expected_data_len) {
     // Read the response from the PN532 into the buffer
-    piconfc_I2C_readdata(block, buffer, 8 + expected_data_len);
-
-    // Validate the preamble and start codes
-    if (buffer[0] != PN532_PREAMBLE || buffer[1] != PN532_STARTCODE1 || buffer[2] != PN532_STARTCODE2) {
-        #ifdef I2C_DEBUG
-            printf("Validate failed Preamble check!\n");
-        #endif
-        return 0;
-    }
-
-    // Validate length and length checksum
-    uint8_t len = buffer[3];
-    uint8_t checksum = len + buffer[4];
-    if (checksum != 0) {
-        #ifdef I2C_DEBUG
-            printf("Validate failed length checksum!\n");
-        #endif
-        return 0;
-    }
+    if (!piconfc_I2C_readdata(transport, buffer, 8 + expected_data_len)) return 0;
 
-    // Validate data direction and calculate data checksum
-    uint8_t direction = buffer[5];
-    uint8_t sum = 0 + direction;
-    for (int i = 1; i < len; i++) {
-        buffer[i - 1] = buffer[5 + i];
-        sum += buffer[5 + i];
-    }
-    sum += buffer[5 + len];
-    if (sum != 0) {
-        #ifdef I2C_DEBUG
-            printf("Validate failed data checksum!\n");
-        #endif
-        return 0;
-    }
+    // Validate the frame and move its data to the start of the buffer
+    int len = piconfc_FRAME_check(buffer, 8 + expected_data_len);
+    if (len < 0) return 0;
 
     // Return the length of the data, excluding the PN532 indicator
-    return len - 1;
+    return len;
 }
 
 // Does what it says
@@ -0,0 +1,198 @@
+#include <string.h>
+
+#include "piconfc_LZ.h"
+#include "piconfc_NDEF.h"
+
+#define LZ_HASH_BITS (9)
+#define LZ_MIN_MATCH (3)
+#define LZ_MAX_LITERALS (128)
+#define LZ_LONG_MATCH (15)                               // Length code that is followed by an extra length byte
+#define LZ_MAX_MATCH (LZ_MIN_MATCH + LZ_LONG_MATCH + 255) // Longest match a token can express
+
+// Dictionary used when creating and reading records
+static const uint8_t *lz_dict = NULL;
+static int lz_dictlen = 0;
+
+// Scratch buffer for payloads compressed before they are placed in a record
+static uint8_t lz_scratch[LZ_MAX_PAYLOAD];
+
+// Identifies a dictionary with one byte of its FNV-1a hash
+static uint8_t lz_dictId(const uint8_t *dict, int dictlen) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < dictlen; i++) hash = (hash ^ dict[i]) * 16777619u;
+    return hash & 0xFF;
+}
+
+// Reads a byte of the dictionary followed by the input as if they were one buffer
+static inline uint8_t lz_byte(const uint8_t *dict, int dictlen, const uint8_t *src, int pos) {
+    return pos < dictlen ? dict[pos] : src[pos - dictlen];
+}
+
+// Hashes the 3 bytes at a position of the dictionary and input
+static inline uint32_t lz_hash(const uint8_t *dict, int dictlen, const uint8_t *src, int pos) {
+    uint32_t v = lz_byte(dict, dictlen, src, pos) << 16 | lz_byte(dict, dictlen, src, pos + 1) << 8 | lz_byte(dict, dictlen, src, pos + 2);
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// Writes literal tokens for src[start, end) of the combined buffer. Returns the new output length or -1.
+static int lz_emitLiterals(int dictlen, const uint8_t *src, int start, int end, uint8_t *dest, int head, int destsize) {
+    while (start < end) {
+        int n = end - start < LZ_MAX_LITERALS ? end - start : LZ_MAX_LITERALS;
+        if (head + 1 + n > destsize) return -1;
+        dest[head++] = n - 1;
+        memcpy(dest + head, src + start - dictlen, n); // Literals always come from the input
+        head += n;
+        start += n;
+    }
+    return head;
+}
+
+void piconfc_LZ_setDictionary(const uint8_t *dict, int dictlen) {
+    lz_dict = dictlen > 0 ? dict : NULL;
+    lz_dictlen = dict != NULL ? dictlen : 0;
+}
+
+int piconfc_LZ_compress(const uint8_t *src, int srclen, uint8_t *dest, int destsize, const uint8_t *dict, int dictlen) {
+    uint16_t table[1 << LZ_HASH_BITS]; // Last position + 1 of each hashed 3-byte sequence, 0 if none
+    int head = 0;
+
+    if (srclen > 0xFFFF) return 0;
+    if (dict == NULL) dictlen = 0;
+    // Only the end of the dictionary is within reach of a match
+    if (dictlen > LZ_MAX_OFFSET) {
+        dict += dictlen - LZ_MAX_OFFSET;
+        dictlen = LZ_MAX_OFFSET;
+    }
+
+    // Write the header
+    if (destsize < LZ_HEADER_LEN + (dictlen > 0 ? 1 : 0)) return 0;
+    dest[head++] = dictlen > 0 ? LZ_FLAG_DICT : 0;
+    dest[head++] = srclen >> 8;
+    dest[head++] = srclen & 0xFF;
+    if (dictlen > 0) dest[head++] = lz_dictId(dict, dictlen);
+
+    memset(table, 0, sizeof(table));
+    int end = dictlen + srclen;
+
+    // Prime the table with the dictionary so the input can refer back into it
+    for (int pos = 0; pos < dictlen && pos + LZ_MIN_MATCH <= end; pos++)
+        table[lz_hash(dict, dictlen, src, pos)] = pos + 1;
+
+    int pos = dictlen;
+    int literals = dictlen; // Start of the pending literal run
+    while (pos + LZ_MIN_MATCH <= end) {
+        uint32_t h = lz_hash(dict, dictlen, src, pos);
+        int candidate = table[h] - 1;
+        table[h] = pos + 1;
+
+        // A candidate is only a match if its bytes really are equal and it is within reach
+        int len = 0;
+        if (candidate >= 0 && pos - candidate <= LZ_MAX_OFFSET) {
+            while (pos + len < end && len < LZ_MAX_MATCH && lz_byte(dict, dictlen, src, candidate + len) == lz_byte(dict, dictlen, src, pos + len))
+                len++;
+        }
+        if (len < LZ_MIN_MATCH) {
+            pos++;
+            continue;
+        }
+
+        // Flush the literals before the match, then write the match token
+        head = lz_emitLiterals(dictlen, src, literals, pos, dest, head, destsize);
+        if (head < 0) return 0;
+        int code = len - LZ_MIN_MATCH < LZ_LONG_MATCH ? len - LZ_MIN_MATCH : LZ_LONG_MATCH;
+        int offset = pos - candidate - 1;
+        if (head + 2 + (code == LZ_LONG_MATCH ? 1 : 0) > destsize) return 0;
+        dest[head++] = 0x80 | code << 3 | offset >> 8;
+        dest[head++] = offset & 0xFF;
+        if (code == LZ_LONG_MATCH) dest[head++] = len - LZ_MIN_MATCH - LZ_LONG_MATCH;
+
+        // Hash the positions covered by the match so later input can refer to them
+        for (int i = pos + 1; i < pos + len && i + LZ_MIN_MATCH <= end; i++)
+            table[lz_hash(dict, dictlen, src, i)] = i + 1;
+        pos += len;
+        literals = pos;
+    }
+
+    // Whatever is left is written as literals
+    head = lz_emitLiterals(dictlen, src, literals, end, dest, head, destsize);
+    return head < 0 ? 0 : head;
+}
+
+int piconfc_LZ_decompress(const uint8_t *src, int srclen, uint8_t *dest, int destsize, const uint8_t *dict, int dictlen) {
+    if (srclen < LZ_HEADER_LEN || (src[0] & ~LZ_FLAG_DICT) != 0) return -1; // Unknown flags
+    int total = src[1] << 8 | src[2];
+    int i = LZ_HEADER_LEN;
+
+    // Only decode with the dictionary the payload was compressed with
+    if (src[0] & LZ_FLAG_DICT) {
+        if (dict == NULL || srclen < LZ_HEADER_LEN + 1) return -1;
+        if (dictlen > LZ_MAX_OFFSET) {
+            dict += dictlen - LZ_MAX_OFFSET;
+            dictlen = LZ_MAX_OFFSET;
+        }
+        if (src[i++] != lz_dictId(dict, dictlen)) return -1;
+    } else {
+        dictlen = 0;
+    }
+
+    // Decode the whole stream, so a malformed one is rejected however small the destination is,
+    // but only write what fits: a short buffer gets the start of the payload
+    int limit = total < destsize ? total : destsize;
+    int out = 0;
+    while (out < total) {
+        if (i >= srclen) return -1; // Tokens ended before the announced length
+        uint8_t token = src[i++];
+
+        if (!(token & 0x80)) {
+            // Literal run
+            int n = token + 1;
+            if (i + n > srclen || out + n > total) return -1;
+            if (out < limit) memcpy(dest + out, src + i, n < limit - out ? n : limit - out);
+            out += n;
+            i += n;
+            continue;
+        }
+
+        // Match, copied byte by byte since it may overlap the bytes it produces
+        if (i >= srclen) return -1;
+        int len = ((token >> 3) & 0x0F) + LZ_MIN_MATCH;
+        int offset = ((token & 0x07) << 8 | src[i++]) + 1;
+        if (len == LZ_MIN_MATCH + LZ_LONG_MATCH) {
+            if (i >= srclen) return -1;
+            len += src[i++];
+        }
+        if (offset > out + dictlen || out + len > total) return -1;
+        int end = out + len;
+        for (; out < end && out < limit; out++) {
+            int from = out - offset;
+            dest[out] = from >= 0 ? dest[from] : dict[dictlen + from];
+        }
+        out = end;
+    }
+    return total;
+}
+
+bool piconfc_LZ_isCompressed(const NDEFRecord *record) {
+    int typelen = sizeof(LZ_EXTERNAL_TYPE) - 1;
+    return record->tnf == TNF_EXTERNAL && record->type_length == typelen && memcmp(record->buffer + record->type_offset, LZ_EXTERNAL_TYPE, typelen) == 0;
+}
+
+int piconfc_LZ_decodeRecord(const NDEFRecord *record, uint8_t *dest, int destsize) {
+    if (!piconfc_LZ_isCompressed(record)) return -1;
+    return piconfc_LZ_decompress(record->buffer + record->data_offset, record->data_length, dest, destsize, lz_dict, lz_dictlen);
+}
+
+bool piconfc_LZ_createRecord(uint8_t **dest, unsigned int *recordlen, uint8_t *payload, unsigned int payloadlen) {
+    int len = piconfc_LZ_compress(payload, payloadlen, lz_scratch, sizeof(lz_scratch), lz_dict, lz_dictlen);
+    if (len == 0) return false;
+    return piconfc_NDEF_createRecord(dest, recordlen, TNF_EXTERNAL, (uint8_t *)LZ_EXTERNAL_TYPE, sizeof(LZ_EXTERNAL_TYPE) - 1, NULL, 0, lz_scratch, len);
+}
+
+bool piconfc_LZ_builderAddRecord(NDEFBuilder *builder, uint8_t *payload, unsigned int payloadlen) {
+    int len = piconfc_LZ_compress(payload, payloadlen, lz_scratch, sizeof(lz_scratch), lz_dict, lz_dictlen);
+    if (len == 0) {
+        builder->failed = true;
+        return false;
+    }
+    return piconfc_NDEF_builderAddRecord(builder, TNF_EXTERNAL, (uint8_t *)LZ_EXTERNAL_TYPE, sizeof(LZ_EXTERNAL_TYPE) - 1, NULL, 0, lz_scratch, len);
+}
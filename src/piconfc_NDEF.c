@@ -1,6 +1,6 @@
 #include "piconfc_NDEF.h"
+#include "piconfc_LZ.h"
 #include <stdlib.h>
-#include "pico/stdlib.h"
 #include <string.h>
 #include <stdio.h>
 
@@ -18,58 +18,273 @@ const char *URIPrefixes[] = {
     "urn:epc:pat:", "urn:epc:raw:", "urn:epc:", "urn:nfc:"
 };
 
-bool piconfc_NDEF_parseTLV(struct TLV *empty_TLV, uint8_t *buffer, int bufsize, int start) {
-    empty_TLV->buffer = buffer;
-    empty_TLV->buffer_len = bufsize;
-    int head = -1;
+// Default allocator hooks backed by the C heap
+static void *ndef_heapAlloc(void *ctx, size_t size) {
+    (void)ctx;
+    return malloc(size);
+}
 
-    // Search for the TLV tag (0x03) starting from the specified offset
-    for (int i = start; i < bufsize; i++) {
-        if (buffer[i] == 0x03) { // Data tag for the NDEF message
-            head = i;
-            break;
-        }
+static void *ndef_heapRealloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    (void)ctx;
+    (void)old_size;
+    return realloc(ptr, new_size);
+}
+
+static void ndef_heapFree(void *ctx, void *ptr) {
+    (void)ctx;
+    free(ptr);
+}
+
+static const NDEFAllocator ndef_heapAllocator = { ndef_heapAlloc, ndef_heapRealloc, ndef_heapFree, NULL };
+
+// Allocator used for every allocation made by this module, and its counters
+static NDEFAllocator ndef_allocator = { ndef_heapAlloc, ndef_heapRealloc, ndef_heapFree, NULL };
+static NDEFAllocStats ndef_stats;
+
+static void *ndef_alloc(size_t size) {
+    void *ptr = ndef_allocator.alloc(ndef_allocator.ctx, size);
+    if (ptr == NULL) {
+        ndef_stats.failures++;
+        return NULL;
     }
-    if (head == -1) // Tag not found
-        return false;
+    ndef_stats.allocations++;
+    ndef_stats.bytes_allocated += size;
+    return ptr;
+}
 
-    // Check if there’s enough space for the length field after the tag
-    if (head + 2 > bufsize) return false;
+static void *ndef_realloc(void *ptr, size_t old_size, size_t new_size) {
+    void *grown = ndef_allocator.realloc(ndef_allocator.ctx, ptr, old_size, new_size);
+    if (grown == NULL) {
+        ndef_stats.failures++;
+        return NULL;
+    }
+    ndef_stats.reallocations++;
+    ndef_stats.bytes_allocated += new_size - old_size;
+    return grown;
+}
+
+void piconfc_NDEF_setAllocator(const NDEFAllocator *allocator) {
+    ndef_allocator = allocator != NULL ? *allocator : ndef_heapAllocator;
+}
+
+void piconfc_NDEF_free(void *ptr) {
+    if (ptr == NULL) return;
+    ndef_stats.frees++;
+    ndef_allocator.free(ndef_allocator.ctx, ptr);
+}
+
+void piconfc_NDEF_allocStats(NDEFAllocStats *stats) {
+    *stats = ndef_stats;
+}
+
+void piconfc_NDEF_resetAllocStats(void) {
+    memset(&ndef_stats, 0, sizeof(ndef_stats));
+}
+
+// Arena allocations are aligned for any of the structures handed out by this module
+#define NDEF_ARENA_ALIGN (sizeof(void *))
+
+static void *ndef_arenaAlloc(void *ctx, size_t size) {
+    NDEFArena *arena = ctx;
+    size_t start = (arena->used + NDEF_ARENA_ALIGN - 1) & ~(NDEF_ARENA_ALIGN - 1);
+    if (start > arena->size || size > arena->size - start) return NULL; // Arena exhausted
+
+    arena->last = start;
+    arena->used = start + size;
+    if (arena->used > arena->peak) arena->peak = arena->used;
+    return arena->buffer + start;
+}
+
+static void *ndef_arenaRealloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    NDEFArena *arena = ctx;
+    if (ptr == NULL) return ndef_arenaAlloc(ctx, new_size);
+
+    // The most recent allocation can grow or shrink in place
+    if ((uint8_t *)ptr == arena->buffer + arena->last) {
+        if (new_size > arena->size - arena->last) return NULL; // Arena exhausted
+        arena->used = arena->last + new_size;
+        if (arena->used > arena->peak) arena->peak = arena->used;
+        return ptr;
+    }
+
+    // Anything older is copied to a new allocation
+    void *grown = ndef_arenaAlloc(ctx, new_size);
+    if (grown == NULL) return NULL;
+    memcpy(grown, ptr, old_size < new_size ? old_size : new_size);
+    return grown;
+}
+
+static void ndef_arenaFree(void *ctx, void *ptr) {
+    (void)ctx;
+    (void)ptr;
+    // Arena memory is only released all at once by piconfc_NDEF_arenaReset
+}
+
+void piconfc_NDEF_arenaInit(NDEFArena *arena, uint8_t *buffer, size_t size) {
+    arena->buffer = buffer;
+    arena->size = size;
+    arena->used = 0;
+    arena->last = 0;
+    arena->peak = 0;
+}
+
+void piconfc_NDEF_arenaReset(NDEFArena *arena) {
+    arena->used = 0;
+    arena->last = 0;
+}
+
+void piconfc_NDEF_arenaAllocator(NDEFArena *arena, NDEFAllocator *allocator) {
+    allocator->alloc = ndef_arenaAlloc;
+    allocator->realloc = ndef_arenaRealloc;
+    allocator->free = ndef_arenaFree;
+    allocator->ctx = arena;
+}
 
-    // Determine the length of the value based on the length encoding
+// Length of each entry of URIPrefixes
+static const uint8_t URIPrefixLengths[] = {
+    0, 11, 12, 7, 8, 4, 7, 26, 10, 7, 7, 6, 6, 6, 6, 5, 9, 5,
+    7, 4, 4, 4, 5, 5, 8, 10, 9, 10, 11, 7, 11, 12, 12, 12, 8, 8
+};
+
+// Prefix IDs grouped by first letter, longest prefix first within each group
+static const uint8_t URIPrefixesByLetter[] = {
+    0x19, 0x1A, 0x18,                         // b
+    0x0E,                                     // d
+    0x07, 0x08, 0x09, 0x1D, 0x0D,             // f
+    0x02, 0x01, 0x04, 0x03,                   // h
+    0x1C, 0x11,                               // i
+    0x06,                                     // m
+    0x0C, 0x0F,                               // n
+    0x14,                                     // p
+    0x12,                                     // r
+    0x0A, 0x0B, 0x16, 0x15,                   // s
+    0x1B, 0x10, 0x17, 0x05,                   // t
+    0x1F, 0x20, 0x21, 0x1E, 0x22, 0x23, 0x13  // u
+};
+
+// Start and count in URIPrefixesByLetter for each letter 'a' to 'z'
+static const uint8_t URIPrefixGroups[26][2] = {
+    {0, 0}, {0, 3}, {3, 0}, {3, 1}, {4, 0}, {4, 5}, {9, 0}, {9, 4}, {13, 2},
+    {15, 0}, {15, 0}, {15, 0}, {15, 1}, {16, 2}, {18, 0}, {18, 1}, {19, 0},
+    {19, 1}, {20, 4}, {24, 4}, {28, 7}, {35, 0}, {35, 0}, {35, 0}, {35, 0}, {35, 0}
+};
+
+// Decodes the 3-byte value of a Lock Control or Memory Control TLV into a reserved area
+static void ndef_addReservedArea(struct TLVMap *map, uint8_t tag, uint8_t *value) {
+    if (map->reserved_count == NDEF_TLV_MAX_RESERVED) return;
+
+    int page_addr = value[0] >> 4;         // Page address, in units of the page size below
+    int byte_offset = value[0] & 0x0F;     // Byte offset within that page
+    int size = value[1] == 0 ? 256 : value[1]; // Lock bits or reserved bytes, 0 means 256
+    int page_size = 1 << (value[2] & 0x0F); // Bytes per page as a power of two
+
+    struct TLVArea *area = &map->reserved[map->reserved_count++];
+    area->address = page_addr * page_size + byte_offset;
+    area->lock = tag == NDEF_TLV_LOCK_CONTROL;
+    area->length = area->lock ? (size + 7) / 8 : size; // Lock sizes are given in bits
+}
+
+// Reads the 1-byte or 3-byte length of the TLV block at head. Returns false if the block is truncated.
+static inline bool ndef_readTLVLength(uint8_t *buffer, int bufsize, int head, int *value_offset, uint16_t *value_length) {
+    if (head + 2 > bufsize) return false;
     if (buffer[head + 1] == 0xFF) {
-        // 3-byte length encoding (extended format)
-        uint16_t len = buffer[head + 2];
-        len <<= 8;
-        len |= buffer[head + 3];
-        empty_TLV->value_length = len;
-        empty_TLV->value_offset = head + 4;
-
-        // Validate that the value is correctly terminated with 0xFE
-        if (buffer[empty_TLV->value_offset + empty_TLV->value_length] != 0xFE)
-            return false;
+        if (head + 4 > bufsize) return false;
+        *value_length = (buffer[head + 2] << 8) | buffer[head + 3];
+        *value_offset = head + 4;
+    } else {
+        *value_length = buffer[head + 1];
+        *value_offset = head + 2;
     }
-    else {
-        // 1-byte length encoding (standard format)
-        empty_TLV->value_length = buffer[head + 1];
-        empty_TLV->value_offset = head + 2;
+    return *value_offset + *value_length <= bufsize;
+}
+
+bool piconfc_NDEF_walkTLV(struct TLVMap *map, uint8_t *buffer, int bufsize, int start) {
+    map->block_count = 0;
+    map->reserved_count = 0;
+    map->ndef_block = -1;
+    map->terminated = false;
+
+    int head = start < 0 ? 0 : start;
+    while (head < bufsize) {
+        uint8_t tag = buffer[head];
 
-        // Validate that the value is correctly terminated with 0xFE
-        if (buffer[empty_TLV->value_offset + empty_TLV->value_length] != 0xFE) {
-            // If the TLV was invalid, retry parsing from the next byte after the tag
-            return piconfc_NDEF_parseTLV(empty_TLV, buffer, bufsize, head + 1);
+        // NULL TLVs are single padding bytes
+        if (tag == NDEF_TLV_NULL) {
+            head++;
+            continue;
+        }
+
+        // The Terminator TLV ends the data area
+        if (tag == NDEF_TLV_TERMINATOR) {
+            map->terminated = true;
+            break;
         }
-    }
 
-    // Set pointer to the start of the value within the buffer
-    empty_TLV->value_ptr = empty_TLV->buffer + empty_TLV->value_offset;
+        // Every other TLV carries a 1-byte or 3-byte length
+        int value_offset;
+        uint16_t value_length;
+        if (!ndef_readTLVLength(buffer, bufsize, head, &value_offset, &value_length)) break; // Truncated block
+
+        // Control TLVs describe memory that user data must not overwrite
+        if ((tag == NDEF_TLV_LOCK_CONTROL || tag == NDEF_TLV_MEMORY_CONTROL) && value_length >= 3)
+            ndef_addReservedArea(map, tag, buffer + value_offset);
+
+        if (map->block_count < NDEF_TLV_MAX_BLOCKS) {
+            if (tag == NDEF_TLV_NDEF && map->ndef_block == -1) map->ndef_block = map->block_count;
+            struct TLVBlock *block = &map->blocks[map->block_count++];
+            block->tag = tag;
+            block->offset = head;
+            block->value_offset = value_offset;
+            block->value_length = value_length;
+        }
+
+        // Step over the whole block to the next TLV
+        head = value_offset + value_length;
+    }
+    map->stop_offset = head;
 
     #ifdef NDEF_DEBUG
-        printf("Parsed TLV: ");
-        printhex(empty_TLV->value_ptr, empty_TLV->value_length); // Print parsed data if debugging
+        printf("Walked %d TLVs, %d reserved areas, NDEF block %d\n", map->block_count, map->reserved_count, map->ndef_block);
     #endif
 
-    return true;
+    return map->ndef_block != -1;
+}
+
+bool piconfc_NDEF_parseTLV(struct TLV *empty_TLV, uint8_t *buffer, int bufsize, int start) {
+    empty_TLV->buffer = buffer;
+    empty_TLV->buffer_len = bufsize;
+
+    // Walk the TLV blocks structurally as piconfc_NDEF_walkTLV does, stopping at the NDEF TLV
+    // without building a map: this is on the path of every tag read
+    int head = start < 0 ? 0 : start;
+    while (head < bufsize) {
+        uint8_t tag = buffer[head];
+        if (tag == NDEF_TLV_NULL) {
+            head++;
+            continue;
+        }
+        if (tag == NDEF_TLV_TERMINATOR) return false;
+
+        int value_offset;
+        uint16_t value_length;
+        if (!ndef_readTLVLength(buffer, bufsize, head, &value_offset, &value_length)) return false;
+        if (tag == NDEF_TLV_NDEF) {
+            empty_TLV->value_offset = value_offset;
+            empty_TLV->value_length = value_length;
+
+            // Set pointer to the start of the value within the buffer
+            empty_TLV->value_ptr = empty_TLV->buffer + empty_TLV->value_offset;
+
+            #ifdef NDEF_DEBUG
+                printf("Parsed TLV: ");
+                printhex(empty_TLV->value_ptr, empty_TLV->value_length); // Print parsed data if debugging
+            #endif
+
+            return true;
+        }
+        head = value_offset + value_length;
+    }
+    return false; // Tag not found
 }
 
 int piconfc_NDEF_encodeTLV(uint8_t *data, uint16_t datasize, uint8_t *result, int resultsize)
@@ -79,7 +294,7 @@ int piconfc_NDEF_encodeTLV(uint8_t *data, uint16_t datasize, uint8_t *result, in
         return 0;
 
     int i = 0;
-    result[i++] = 0x03; // Start with the TLV tag (0x03 for NDEF data)
+    result[i++] = NDEF_TLV_NDEF; // Start with the TLV tag (0x03 for NDEF data)
 
     // Encode the length of the data
     if (datasize >= 0xFF) {
@@ -97,35 +312,117 @@ int piconfc_NDEF_encodeTLV(uint8_t *data, uint16_t datasize, uint8_t *result, in
         result[i++] = data[j];
     }
 
-    result[i++] = 0xFE; // Add terminator (0xFE)
+    result[i++] = NDEF_TLV_TERMINATOR; // Add terminator (0xFE)
 
     return i; // Return the length of the encoded TLV packet
 }
 
-int piconfc_NDEF_parseMessage(uint8_t *buffer, int bufsize, NDEFRecord **dest) {
-    int expected_records = piconfc_NDEF_messageLen(buffer, bufsize);
-    if (expected_records == 0) // Corrected condition to check if no records are found
-        return 0;
+void piconfc_NDEF_iteratorInit(NDEFIterator *it, uint8_t *buffer, int bufsize) {
+    it->buffer = buffer;
+    it->bufsize = bufsize;
+    it->offset = 0;
+    it->depth = 0;
+    it->done = bufsize < 1; // An empty buffer has no records
+}
+
+bool piconfc_NDEF_iteratorDescend(const NDEFIterator *parent, const NDEFRecord *record, NDEFIterator *child) {
+    // Refuse to nest deeper than the limit, so crafted messages cannot recurse without bound
+    if (parent->depth >= NDEF_MAX_DEPTH) return false;
+
+    // The payload is only parsed once the child iterator is advanced
+    piconfc_NDEF_iteratorInit(child, record->buffer + record->data_offset, record->data_length);
+    child->depth = parent->depth + 1;
+    return true;
+}
 
-    // Allocate memory for the array of NDEF records
-    NDEFRecord *records = (NDEFRecord *)malloc(expected_records * sizeof(NDEFRecord));
-    if (records == NULL) {
-        return 0; // Return 0 if memory allocation fails
+bool piconfc_NDEF_iteratorNext(NDEFIterator *it, NDEFRecord *record) {
+    if (it->done || it->offset >= it->bufsize) return false;
+
+    // Parse the record in place; a record that does not fit ends the iteration
+    int record_start = it->offset;
+    int new_offset = piconfc_NDEF_parseRecord(it->buffer, it->bufsize, record_start, record);
+    if (new_offset == -1) {
+        it->done = true;
+        return false;
     }
-    #ifdef NDEF_DEBUG
-        printf("Allocated %d bytes for parseMessage\n", expected_records * sizeof(NDEFRecord));
-    #endif
 
-    // Parse each record and store it in the records array
+    // Stop after the record carrying the ME (Message End) flag
+    if (it->buffer[record_start] & 0x40) it->done = true;
+    it->offset = new_offset;
+    return true;
+}
+
+bool piconfc_NDEF_iteratorNextChunked(NDEFIterator *it, NDEFChunkedRecord *record) {
+    NDEFRecord chunk;
+    if (!piconfc_NDEF_iteratorNext(it, &record->first)) return false;
+
+    // The first chunk carries the type; TNF_UNCHANGED is only valid on later chunks
+    if (record->first.tnf == TNF_UNCHANGED) {
+        it->done = true;
+        return false;
+    }
+    record->chunks[0] = piconfc_NDEF_recordPayload(&record->first);
+    record->chunk_count = 1;
+    record->payload_length = record->first.data_length;
+
+    // Collect the following chunks until the one without the CF flag
+    bool more = record->first.flags & NDEF_FLAG_CF;
+    while (more) {
+        if (!piconfc_NDEF_iteratorNext(it, &chunk)) {
+            it->done = true;
+            return false; // Message ended inside a chunked record
+        }
+        // Later chunks have TNF_UNCHANGED, no type and no ID
+        if (chunk.tnf != TNF_UNCHANGED || chunk.type_length != 0 || chunk.id_length != 0 || record->chunk_count == NDEF_MAX_CHUNKS) {
+            it->done = true;
+            return false;
+        }
+        record->chunks[record->chunk_count++] = piconfc_NDEF_recordPayload(&chunk);
+        record->payload_length += chunk.data_length;
+        more = chunk.flags & NDEF_FLAG_CF;
+    }
+    return true;
+}
+
+uint32_t piconfc_NDEF_gatherPayload(const NDEFChunkedRecord *record, uint8_t *dest, uint32_t destsize) {
+    uint32_t head = 0;
+
+    // Copy each chunk in order, stopping when the destination is full
+    for (int i = 0; i < record->chunk_count && head < destsize; i++) {
+        uint32_t n = record->chunks[i].len;
+        if (n > destsize - head) n = destsize - head;
+        memcpy(dest + head, record->chunks[i].ptr, n);
+        head += n;
+    }
+    return record->payload_length;
+}
+
+int piconfc_NDEF_parseMessage(uint8_t *buffer, int bufsize, NDEFRecord **dest) {
+    NDEFIterator it;
+    piconfc_NDEF_iteratorInit(&it, buffer, bufsize);
+
+    NDEFRecord *records = NULL;
+    int capacity = 0;
     int records_parsed = 0;
-    int offset = 0;
-    while (offset <= bufsize && records_parsed < expected_records) {
-        int new_offset = piconfc_NDEF_parseRecord(buffer, bufsize, offset, &records[records_parsed]);
-        if (new_offset == -1) {
-            break;
+    NDEFRecord record;
+
+    // Parse each record once, growing the array as records are found
+    while (piconfc_NDEF_iteratorNext(&it, &record)) {
+        if (records_parsed == capacity) {
+            int old_capacity = capacity;
+            capacity = capacity == 0 ? 1 : capacity * 2;
+            NDEFRecord *grown = (NDEFRecord *)ndef_realloc(records, old_capacity * sizeof(NDEFRecord), capacity * sizeof(NDEFRecord));
+            if (grown == NULL) {
+                piconfc_NDEF_free(records);
+                *dest = NULL;
+                return 0; // Return 0 if memory allocation fails
+            }
+            records = grown;
+            #ifdef NDEF_DEBUG
+                printf("Allocated %d bytes for parseMessage\n", (int)(capacity * sizeof(NDEFRecord)));
+            #endif
         }
-        records_parsed++;
-        offset = new_offset;
+        records[records_parsed++] = record;
     }
 
     *dest = records; // Set the destination pointer to the records array
@@ -136,69 +433,24 @@ int piconfc_NDEF_parseMessage(uint8_t *buffer, int bufsize, NDEFRecord **dest) {
 }
 
 int piconfc_NDEF_messageLen(uint8_t *buffer, int bufsize) {
+    NDEFIterator it;
+    NDEFRecord record;
     int totalRecords = 0;
 
-    // Check if buffer is empty or if the first record has the ME (Message End) flag set
-    if (bufsize < 1 || (buffer[0] & 0x40)) {
+    // Count the records the iterator can parse
+    piconfc_NDEF_iteratorInit(&it, buffer, bufsize);
+    while (piconfc_NDEF_iteratorNext(&it, &record)) {
         #ifdef NDEF_DEBUG
-            printf("Found message end at first record. Returning 1\n");
+            printf("Incremented total records to %d\n", totalRecords + 1);
         #endif
-        return 1; // Return 1 if there's only one record with ME flag set
-    }
-
-    int i = 0;
-    // Iterate through the buffer to count the records
-    while (i < bufsize) {
-        // Stop if the current record has the ME (Message End) flag set
-        if (buffer[i] & 0x40) {
-            break;
-        }
-
-        uint8_t flags = buffer[i++];
-        bool short_record = flags & 0x10; // Check if it's a short record
-        bool has_id = flags & 0x08;       // Check if the record has an ID field
-        uint8_t type_len = buffer[i++];   // Length of the type field
-
-        uint32_t payload_len = 0;
-        // Determine payload length based on record format
-        if (short_record) {
-            payload_len = buffer[i++]; // 1-byte payload length for short records
-        } else {
-            // 4-byte payload length for standard records
-            uint32_t len1 = buffer[i++];
-            uint32_t len2 = buffer[i++];
-            uint32_t len3 = buffer[i++];
-            uint32_t len4 = buffer[i++];
-            payload_len = (len1 << 24) | (len2 << 16) | (len3 << 8) | len4;
-        }
-
-        int id_len = 0;
-        // Check if the record has an ID field and get its length
-        if (has_id) {
-            id_len = buffer[i++];
-        }
-
-        // Skip over the type field
-        i += type_len;
-
-        // Skip over the ID field if present
-        i += id_len;
-
-        // Skip over the payload
-        i += payload_len;
-
-        // Increment the total record count
-            #ifdef NDEF_DEBUG
-                    printf("Incremented total records to %d\n", totalRecords + 1);
-            #endif
-            totalRecords++;
+        totalRecords++;
     }
     return totalRecords;
 }
 
 int piconfc_NDEF_parseRecord(uint8_t *buffer, int bufsize, int offset, NDEFRecord *empty_record) {
-    // Check if there is enough space in the buffer for the minimum record length
-    if (offset + 4 >= bufsize) return -1;
+    // Every record needs at least the flags, type length and a 1-byte payload length
+    if (offset < 0 || offset + 3 > bufsize) return -1;
 
     int ptr = offset;
 
@@ -213,31 +465,37 @@ int piconfc_NDEF_parseRecord(uint8_t *buffer, int bufsize, int offset, NDEFRecor
     ptr += 1;
 
     // Determine payload length based on the Short Record (SR) flag
-    int payload_data_len = 0;
+    uint32_t payload_data_len = 0;
     if (sr) {
         // 1-byte payload length for short records
         payload_data_len = buffer[ptr];
         ptr += 1;
     } else {
         // 4-byte payload length for standard records
-        payload_data_len = (buffer[ptr] << 24) | (buffer[ptr + 1] << 16) | (buffer[ptr + 2] << 8) | buffer[ptr + 3];
+        if (ptr + 4 > bufsize) return -1;
+        payload_data_len = ((uint32_t)buffer[ptr] << 24) | (buffer[ptr + 1] << 16) | (buffer[ptr + 2] << 8) | buffer[ptr + 3];
         ptr += 4;
     }
 
     // If the IL (ID Length) flag is set, a 1-byte ID length field is present
     uint8_t payload_id_len = 0;
     if (il) {
+        if (ptr + 1 > bufsize) return -1;
         payload_id_len = buffer[ptr];
         ptr += 1;
     }
 
+    // Check that type, ID and payload all fit in the rest of the buffer before using them.
+    // The payload length is compared unsigned so a 4-byte length cannot overflow the offsets.
+    int remaining = bufsize - ptr;
+    if (payload_type_len + payload_id_len > remaining) return -1;
+    if (payload_data_len > (uint32_t)(remaining - payload_type_len - payload_id_len)) return -1;
+
     // Set the type offset if type length is greater than zero
     int payload_type_offset = 0;
     if (payload_type_len > 0) {
         payload_type_offset = ptr;
         ptr += payload_type_len;
-        // Check if buffer has enough space for the type field
-        if (payload_type_offset + payload_type_len > bufsize) return -1;
     }
 
     // Set the ID offset if ID length is greater than zero
@@ -245,8 +503,6 @@ int piconfc_NDEF_parseRecord(uint8_t *buffer, int bufsize, int offset, NDEFRecor
     if (payload_id_len > 0) {
         payload_id_offset = ptr;
         ptr += payload_id_len;
-        // Check if buffer has enough space for the ID field
-        if (payload_id_offset + payload_id_len > bufsize) return -1;
     }
 
     // Set the data offset if payload length is greater than zero
@@ -254,12 +510,11 @@ int piconfc_NDEF_parseRecord(uint8_t *buffer, int bufsize, int offset, NDEFRecor
     if (payload_data_len > 0) {
         payload_data_offset = ptr;
         ptr += payload_data_len;
-        // Check if buffer has enough space for the payload data
-        if (payload_data_offset + payload_data_len > bufsize) return -1;
     }
 
     // Populate the NDEFRecord structure with parsed data and offsets
     empty_record->tnf = tnf;
+    empty_record->flags = buffer[offset] & 0xF8;
     empty_record->buffer = buffer;
     empty_record->data_offset = payload_data_offset;
     empty_record->data_length = payload_data_len;
@@ -274,7 +529,7 @@ int piconfc_NDEF_parseRecord(uint8_t *buffer, int bufsize, int offset, NDEFRecor
 
 bool piconfc_NDEF_createRecord(uint8_t **dest, unsigned int *recordlen, enum TNF tnf, uint8_t *type, uint8_t typelen, uint8_t *id, uint8_t idlen, uint8_t *payload, unsigned int payloadlen) {
     uint32_t len = 0;
-    uint8_t flags = tnf; 
+    uint8_t flags = tnf | 0xC0; // MB and ME flags: the record is a whole message
     len += sizeof(flags); // Account for flags byte
     len += sizeof(typelen); // Account for type length byte
 
@@ -298,7 +553,7 @@ bool piconfc_NDEF_createRecord(uint8_t **dest, unsigned int *recordlen, enum TNF
     len += payloadlen;
 
     // Allocate memory for the record
-    uint8_t* record = (uint8_t *)malloc(len);
+    uint8_t* record = (uint8_t *)ndef_alloc(len);
     if (record == NULL) 
         return false; // Return false if memory allocation fails
 
@@ -344,68 +599,741 @@ bool piconfc_NDEF_createRecord(uint8_t **dest, unsigned int *recordlen, enum TNF
     return true;
 }
 
+void piconfc_NDEF_builderInit(NDEFBuilder *builder, uint8_t *buffer, int bufsize) {
+    builder->buffer = buffer;
+    builder->bufsize = bufsize;
+    builder->open_payload = -1;
+    // Reserve the 3-byte length form only if the buffer can hold a message that needs it
+    builder->header_len = bufsize - 2 - 1 >= 0xFF ? 4 : 2;
+    builder->head = builder->header_len;
+    builder->last_record = -1;
+    builder->failed = bufsize < 3; // Room for at least an empty TLV and the terminator
+}
+
+// Writes a record header, type and ID and reserves room for the payload behind them.
+// Returns a pointer to the payload, or NULL if the record does not fit.
+static uint8_t *ndef_builderReserveForm(NDEFBuilder *builder, enum TNF tnf, uint8_t *type, uint8_t typelen, uint8_t *id, uint8_t idlen, unsigned int payloadlen, bool short_record) {
+    if (builder->failed || builder->open_payload != -1) return NULL;
+
+    uint32_t len = 2 + (short_record ? 1 : 4) + (idlen > 0 ? 1 : 0) + typelen + idlen;
+
+    // The record and the terminator TLV must fit in what is left of the buffer
+    int remaining = builder->bufsize - builder->head - 1;
+    if (remaining < 0 || len > (uint32_t)remaining || payloadlen > (uint32_t)remaining - len) {
+        builder->failed = true;
+        return NULL;
+    }
+
+    uint8_t flags = tnf;
+    if (builder->last_record == -1) flags |= 0x80; // MB flag on the first record
+    if (short_record) flags |= 0x10;              // SR flag
+    if (idlen > 0) flags |= 0x08;                 // IL flag
+
+    uint8_t *record = builder->buffer + builder->head;
+    int i = 0;
+    record[i++] = flags;   // Set flags and TNF
+    record[i++] = typelen; // Set type length
+
+    // Set payload length based on short or standard format
+    if (short_record) {
+        record[i++] = (uint8_t) payloadlen;
+    } else {
+        record[i++] = (uint8_t)((payloadlen >> 24) & 0xFF);
+        record[i++] = (uint8_t)((payloadlen >> 16) & 0xFF);
+        record[i++] = (uint8_t)((payloadlen >> 8) & 0xFF);
+        record[i++] = (uint8_t)(payloadlen & 0xFF);
+    }
+    if (idlen > 0) record[i++] = idlen;
+
+    // Copy type and ID straight into their final position
+    if (typelen > 0) {
+        memcpy(record + i, type, typelen);
+        i += typelen;
+    }
+    if (idlen > 0) {
+        memcpy(record + i, id, idlen);
+        i += idlen;
+    }
+
+    builder->last_record = builder->head;
+    builder->head += i + payloadlen;
+    return record + i;
+}
+
+// Reserves a record with the short header form whenever the payload length allows it
+static uint8_t *ndef_builderReserve(NDEFBuilder *builder, enum TNF tnf, uint8_t *type, uint8_t typelen, uint8_t *id, uint8_t idlen, unsigned int payloadlen) {
+    return ndef_builderReserveForm(builder, tnf, type, typelen, id, idlen, payloadlen, payloadlen < 256);
+}
+
+uint8_t *piconfc_NDEF_builderOpenRecord(NDEFBuilder *builder, enum TNF tnf, uint8_t *type, uint8_t typelen, uint8_t *id, uint8_t idlen, int *room) {
+    // The payload length is unknown until the record is closed, so reserve the 4-byte form
+    uint8_t *payload = ndef_builderReserveForm(builder, tnf, type, typelen, id, idlen, 0, false);
+    if (payload == NULL) return NULL;
+
+    builder->open_payload = builder->head;
+    *room = builder->bufsize - builder->head - 1; // Keep room for the terminator TLV
+    return payload;
+}
+
+bool piconfc_NDEF_builderCloseRecord(NDEFBuilder *builder, unsigned int payloadlen) {
+    if (builder->open_payload == -1) return false;
+    int payload = builder->open_payload;
+    builder->open_payload = -1;
+    if (payloadlen > (unsigned int)(builder->bufsize - payload - 1)) {
+        builder->failed = true;
+        return false;
+    }
+
+    uint8_t *record = builder->buffer + builder->last_record;
+    if (payloadlen < 256) {
+        // Switch to the short form by moving everything after the length field down 3 bytes
+        memmove(record + 3, record + 6, payload - builder->last_record - 6 + payloadlen);
+        record[0] |= NDEF_FLAG_SR;
+        record[2] = payloadlen;
+        builder->head = payload - 3 + payloadlen;
+    } else {
+        record[2] = (uint8_t)((payloadlen >> 24) & 0xFF);
+        record[3] = (uint8_t)((payloadlen >> 16) & 0xFF);
+        record[4] = (uint8_t)((payloadlen >> 8) & 0xFF);
+        record[5] = (uint8_t)(payloadlen & 0xFF);
+        builder->head = payload + payloadlen;
+    }
+    return true;
+}
+
+bool piconfc_NDEF_builderAddRecord(NDEFBuilder *builder, enum TNF tnf, uint8_t *type, uint8_t typelen, uint8_t *id, uint8_t idlen, uint8_t *payload, unsigned int payloadlen) {
+    uint8_t *dest = ndef_builderReserve(builder, tnf, type, typelen, id, idlen, payloadlen);
+    if (dest == NULL) return false;
+    memcpy(dest, payload, payloadlen); // Copy the payload straight into its final position
+    return true;
+}
+
+bool piconfc_NDEF_builderAddChunkedRecord(NDEFBuilder *builder, enum TNF tnf, uint8_t *type, uint8_t typelen, uint8_t *id, uint8_t idlen, uint8_t *payload, unsigned int payloadlen, unsigned int chunk_size) {
+    if (chunk_size == 0) {
+        builder->failed = true;
+        return false;
+    }
+
+    // The first chunk carries the TNF, type and ID
+    unsigned int n = payloadlen < chunk_size ? payloadlen : chunk_size;
+    uint8_t *dest = ndef_builderReserve(builder, tnf, type, typelen, id, idlen, n);
+    if (dest == NULL) return false;
+    memcpy(dest, payload, n);
+
+    // Every further chunk has TNF_UNCHANGED and no type or ID
+    for (unsigned int done = n; done < payloadlen; done += n) {
+        builder->buffer[builder->last_record] |= NDEF_FLAG_CF; // More chunks follow
+        n = payloadlen - done < chunk_size ? payloadlen - done : chunk_size;
+        dest = ndef_builderReserve(builder, TNF_UNCHANGED, NULL, 0, NULL, 0, n);
+        if (dest == NULL) return false;
+        memcpy(dest, payload + done, n);
+    }
+    return true;
+}
+
+uint8_t piconfc_NDEF_uriPrefix(const char *uri, int *prefix_len) {
+    *prefix_len = 0;
+
+    // Every prefix starts with a lowercase letter, which selects a small group of candidates
+    unsigned char first = uri[0];
+    if (first < 'a' || first > 'z') return NDEF_URIPREFIX_NONE;
+    const uint8_t *group = URIPrefixGroups[first - 'a'];
+
+    // Candidates are ordered longest first, so the first match is the best one
+    for (int i = group[0]; i < group[0] + group[1]; i++) {
+        uint8_t prefix_id = URIPrefixesByLetter[i];
+        if (strncmp(uri, URIPrefixes[prefix_id], URIPrefixLengths[prefix_id]) == 0) {
+            *prefix_len = URIPrefixLengths[prefix_id];
+            return prefix_id;
+        }
+    }
+    return NDEF_URIPREFIX_NONE;
+}
+
+int piconfc_NDEF_encodeURIPayload(const char *uri, uint8_t *dest, int destsize) {
+    int prefix_len;
+    uint8_t prefix_id = piconfc_NDEF_uriPrefix(uri, &prefix_len);
+    int rest = strlen(uri) - prefix_len;
+    if (rest + 1 > destsize) return 0;
+
+    dest[0] = prefix_id; // Identifier code replaces the prefix
+    memcpy(dest + 1, uri + prefix_len, rest);
+    return rest + 1;
+}
+
+bool piconfc_NDEF_builderAddURI(NDEFBuilder *builder, const char *uri) {
+    int prefix_len;
+    uint8_t prefix_id = piconfc_NDEF_uriPrefix(uri, &prefix_len);
+    int rest = strlen(uri) - prefix_len;
+
+    // Write the identifier code and the rest of the URI straight into the record payload
+    uint8_t *dest = ndef_builderReserve(builder, TNF_WELLKNOWN, (uint8_t *)"U", 1, NULL, 0, rest + 1);
+    if (dest == NULL) return false;
+    dest[0] = prefix_id;
+    memcpy(dest + 1, uri + prefix_len, rest);
+    return true;
+}
+
+int piconfc_NDEF_builderFinish(NDEFBuilder *builder) {
+    if (builder->failed || builder->open_payload != -1) return 0;
+
+    uint8_t *buffer = builder->buffer;
+    int msglen = builder->head - builder->header_len;
+    if (msglen > 0xFFFE) return 0; // Longest length the 3-byte form can express
+
+    // Mark the last record as the end of the message
+    if (builder->last_record != -1) buffer[builder->last_record] |= 0x40; // ME flag
+
+    // Use the 1-byte length form for short messages, as the TLV format requires
+    if (builder->header_len == 4 && msglen < 0xFF) {
+        memmove(buffer + 2, buffer + 4, msglen);
+        builder->header_len = 2;
+        builder->head -= 2;
+        if (builder->last_record != -1) builder->last_record -= 2;
+    }
+
+    // Patch the TLV header reserved in front of the message
+    buffer[0] = NDEF_TLV_NDEF;
+    if (builder->header_len == 4) {
+        buffer[1] = 0xFF;
+        buffer[2] = msglen >> 8;
+        buffer[3] = msglen & 0xFF;
+    } else {
+        buffer[1] = msglen;
+    }
+
+    // Terminate and pad the image to whole pages
+    int len = builder->head;
+    buffer[len++] = NDEF_TLV_TERMINATOR;
+    int padded = (len + NDEF_IMAGE_ALIGN - 1) / NDEF_IMAGE_ALIGN * NDEF_IMAGE_ALIGN;
+    if (padded > builder->bufsize) return 0;
+    memset(buffer + len, 0, padded - len);
+    return padded;
+}
+
+NDEFSlice piconfc_NDEF_recordType(const NDEFRecord *record) {
+    NDEFSlice slice = { record->buffer + record->type_offset, record->type_length };
+    return slice;
+}
+
+NDEFSlice piconfc_NDEF_recordId(const NDEFRecord *record) {
+    NDEFSlice slice = { record->buffer + record->id_offset, record->id_length };
+    return slice;
+}
+
+NDEFSlice piconfc_NDEF_recordPayload(const NDEFRecord *record) {
+    NDEFSlice slice = { record->buffer + record->data_offset, record->data_length };
+    return slice;
+}
+
+// Copies a slice into dest snprintf-style, truncating and always null-terminating
+static int ndef_copySlice(const uint8_t *data, int len, char *dest, int destsize) {
+    if (destsize > 0) {
+        int n = len < destsize - 1 ? len : destsize - 1;
+        memcpy(dest, data, n);
+        dest[n] = 0x00;
+    }
+    return len;
+}
+
+int piconfc_NDEF_copyMIMEString(const NDEFRecord *record, char *dest, int destsize) {
+    // Check if the record's TNF (Type Name Format) indicates a MIME type
+    if (record->tnf != TNF_MIME) return -1;
+
+    // The MIME type is the record type
+    return ndef_copySlice(record->buffer + record->type_offset, record->type_length, dest, destsize);
+}
+
+// Checks whether a record is of a well-known type such as "U", "T" or "Sp"
+static bool ndef_isWellKnownType(const NDEFRecord *record, const char *type) {
+    int len = strlen(type);
+    return record->tnf == TNF_WELLKNOWN && record->type_length == len && memcmp(record->buffer + record->type_offset, type, len) == 0;
+}
+
+// Drops a multi-byte sequence cut off at the end of a truncated, otherwise valid UTF-8 string
+static int ndef_trimUTF8(const char *string, int len) {
+    int start = len;
+    // Walk back over the continuation bytes to the lead byte of the last sequence
+    while (start > 0 && len - start < 3 && ((uint8_t)string[start - 1] & 0xC0) == 0x80) start--;
+    if (start == 0) return len;
+
+    uint8_t lead = string[start - 1];
+    int needed = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+    return len - (start - 1) < needed ? start - 1 : len;
+}
+
+int piconfc_NDEF_writePayloadString(const NDEFRecord *record, NDEFSink sink, void *ctx) {
+    const uint8_t *data = record->buffer + record->data_offset;
+    int data_len = record->data_length;
+
+    // Compressed payloads need the output as their window, see piconfc_NDEF_copyPayloadString
+    if (piconfc_LZ_isCompressed(record)) return -1;
+
+    // Text records are decoded to UTF-8 without the status byte and language code
+    if (ndef_isWellKnownType(record, "T")) {
+        NDEFText text;
+        if (!piconfc_NDEF_parseText(record, &text)) return -1;
+        return piconfc_NDEF_writeText(&text, sink, ctx);
+    }
+
+    // Check if the record's TNF indicates a URI and its type is 'U' (URI identifier code)
+    if (ndef_isWellKnownType(record, "U")) {
+        // A URI payload always starts with the prefix ID byte
+        if (data_len < 1) return -1;
+        // Verify that the prefix ID is within a valid range
+        if (data[0] >= sizeof(URIPrefixLengths)) return -1; // Invalid prefix ID
+        uint8_t prefix_id = data[0];
+
+        // Emit the expanded prefix, then the rest of the payload after the prefix byte
+        if (URIPrefixLengths[prefix_id] > 0) sink(ctx, (const uint8_t *)URIPrefixes[prefix_id], URIPrefixLengths[prefix_id]);
+        data++;
+        data_len--;
+        if (data_len > 0) sink(ctx, data, data_len);
+        return URIPrefixLengths[prefix_id] + data_len;
+    }
+
+    // Any other payload is emitted as is
+    if (data_len > 0) sink(ctx, data, data_len);
+    return data_len;
+}
+
+// Sink state for piconfc_NDEF_copyPayloadString
+typedef struct {
+    char *dest;
+    int destsize;
+    int head;
+} NDEFCopySink;
+
+static void ndef_copySink(void *ctx, const uint8_t *data, int len) {
+    NDEFCopySink *copy = ctx;
+    // Keep room for the null terminator and drop whatever does not fit
+    int room = copy->destsize - 1 - copy->head;
+    if (room > 0) {
+        int n = len < room ? len : room;
+        memcpy(copy->dest + copy->head, data, n);
+        copy->head += n;
+    }
+}
+
+int piconfc_NDEF_copyPayloadString(const NDEFRecord *record, char *dest, int destsize) {
+    // Compressed payloads are decoded straight into the destination
+    if (piconfc_LZ_isCompressed(record)) {
+        int total = piconfc_LZ_decodeRecord(record, (uint8_t *)dest, destsize > 0 ? destsize - 1 : 0);
+        if (total < 0) {
+            if (destsize > 0) dest[0] = 0x00; // Leave an empty string, not a partly decoded one
+            return -1;
+        }
+        if (destsize > 0) dest[total < destsize - 1 ? total : destsize - 1] = 0x00; // Null-terminate, even when truncated
+        return total;
+    }
+
+    NDEFCopySink copy = { dest, destsize, 0 };
+    int total = piconfc_NDEF_writePayloadString(record, ndef_copySink, &copy);
+    if (total < 0) {
+        if (destsize > 0) dest[0] = 0x00; // Leave an empty string, not a partly written one
+        return -1;
+    }
+    // Truncated text must not end in the middle of a character
+    if (total > copy.head && ndef_isWellKnownType(record, "T")) copy.head = ndef_trimUTF8(dest, copy.head);
+    if (destsize > 0) dest[copy.head] = 0x00; // Null-terminate, even when truncated
+    return total;
+}
+
 bool piconfc_NDEF_readMIMEString(NDEFRecord *record, char **string) {
     // Check if the record's TNF (Type Name Format) indicates a MIME type
     if (record->tnf != TNF_MIME) return false;
 
     // Allocate memory for the MIME type string (+1 for the null terminator)
-    *string = malloc(record->type_length + 1);
+    *string = ndef_alloc(record->type_length + 1);
     if (*string == NULL) return false; // Return false if memory allocation fails
 
-    // Copy the MIME type data from the record buffer to the allocated string
-    memcpy(*string, record->buffer + record->type_offset, record->type_length);
-    (*string)[record->type_length] = 0x00; // Null-terminate the string
-
+    piconfc_NDEF_copyMIMEString(record, *string, record->type_length + 1);
     return true;
 }
 
 bool piconfc_NDEF_readPayloadString(NDEFRecord *record, char **string) {
-    uint8_t prefix_id = 0x00;
-    int prefix_len = 0x00;
-    const char *prefix = NULL;
+    // Measure the final string first by copying into an empty buffer
+    int total_length = piconfc_NDEF_copyPayloadString(record, NULL, 0);
+    if (total_length < 0) return false;
 
-    // Check if the record's TNF indicates a URI and its type is 'U' (URI identifier code)
-    if (record->tnf == TNF_WELLKNOWN && record->type_length == 1 && record->buffer[record->type_offset] == 'U') {
-        // Verify that the prefix ID is within a valid range
-        if (record->buffer[record->data_offset] >= 36) return false; // Invalid prefix ID
-        prefix_id = record->buffer[record->data_offset];
-        prefix = URIPrefixes[prefix_id];
-        prefix_len = strlen(prefix);
+    // Allocate memory for the complete string plus null terminator
+    char *final = ndef_alloc(total_length + 1);
+    if (final == NULL) return false; // Return false if memory allocation fails
+
+    // The measuring pass has checked the payload, but never hand out a string that was not written
+    if (piconfc_NDEF_copyPayloadString(record, final, total_length + 1) != total_length) {
+        piconfc_NDEF_free(final);
+        return false;
     }
+    *string = final; // Set the output string pointer to the allocated string
+    return true;
+}
 
-    // Calculate the total length needed for the final URI string, including prefix (if present)
-    int total_length = prefix_len + record->data_length;
-    if (prefix_len > 0) {
-        total_length -= 1; // Adjust length to exclude the prefix byte in data
+bool piconfc_NDEF_validateUTF8(const uint8_t *data, int len) {
+    int i = 0;
+    while (i < len) {
+        // Skip a whole word at a time while the text is ASCII, which is the common case
+        if (i + 4 <= len) {
+            uint32_t word;
+            memcpy(&word, data + i, 4);
+            if ((word & 0x80808080) == 0) {
+                i += 4;
+                continue;
+            }
+        }
+
+        uint8_t lead = data[i];
+        if (lead < 0x80) {
+            i++;
+            continue;
+        }
+
+        // Decode the length and minimum code point of the sequence from its lead byte
+        int extra;
+        uint32_t codepoint, minimum;
+        if ((lead & 0xE0) == 0xC0) {
+            extra = 1; codepoint = lead & 0x1F; minimum = 0x80;
+        } else if ((lead & 0xF0) == 0xE0) {
+            extra = 2; codepoint = lead & 0x0F; minimum = 0x800;
+        } else if ((lead & 0xF8) == 0xF0) {
+            extra = 3; codepoint = lead & 0x07; minimum = 0x10000;
+        } else {
+            return false; // Stray continuation byte or invalid lead byte
+        }
+        if (i + extra >= len) return false; // Sequence cut off by the end of the buffer
+
+        for (int k = 1; k <= extra; k++) {
+            if ((data[i + k] & 0xC0) != 0x80) return false;
+            codepoint = (codepoint << 6) | (data[i + k] & 0x3F);
+        }
+
+        // Reject overlong forms, surrogates and code points past U+10FFFF
+        if (codepoint < minimum || codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF)) return false;
+        i += extra + 1;
     }
+    return true;
+}
 
-    // Allocate memory for the complete URI plus null terminator
-    char *final = malloc(total_length + 1);
-    if (final == NULL) return false; // Return false if memory allocation fails
+// Transcodes UTF-16 to UTF-8 through a sink in small batches. A NULL sink only measures.
+// Returns the UTF-8 length, or -1 if the UTF-16 is malformed.
+static int ndef_utf16Transcode(const uint8_t *data, int len, NDEFSink sink, void *ctx) {
+    if (len % 2 != 0) return -1;
 
+    // A byte order mark selects the byte order, which is big endian without one
+    bool little_endian = false;
+    int i = 0;
+    if (len >= 2 && data[0] == 0xFE && data[1] == 0xFF) {
+        i = 2;
+    } else if (len >= 2 && data[0] == 0xFF && data[1] == 0xFE) {
+        little_endian = true;
+        i = 2;
+    }
+
+    uint8_t out[32];
     int head = 0;
-    int data_head = record->data_offset;
-    int data_max = record->data_length;
+    int total = 0;
+    while (i < len) {
+        uint32_t codepoint = little_endian ? (data[i] | data[i + 1] << 8) : (data[i] << 8 | data[i + 1]);
+        i += 2;
+
+        // Join surrogate pairs; unpaired surrogates are malformed
+        if (codepoint >= 0xD800 && codepoint <= 0xDBFF) {
+            if (i + 2 > len) return -1;
+            uint32_t low = little_endian ? (data[i] | data[i + 1] << 8) : (data[i] << 8 | data[i + 1]);
+            if (low < 0xDC00 || low > 0xDFFF) return -1;
+            codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+            i += 2;
+        } else if (codepoint >= 0xDC00 && codepoint <= 0xDFFF) {
+            return -1;
+        }
 
-    // Copy the URI prefix if it exists
-    if (prefix_len > 0) {
-        for (int i = 0; i < prefix_len; i++) {
-            final[head] = prefix[i];
-            head++;
+        // Flush the batch when the next character might not fit
+        if (head > (int)sizeof(out) - 4) {
+            if (sink != NULL) sink(ctx, out, head);
+            total += head;
+            head = 0;
+        }
+
+        // Encode the code point as UTF-8
+        if (codepoint < 0x80) {
+            out[head++] = codepoint;
+        } else if (codepoint < 0x800) {
+            out[head++] = 0xC0 | (codepoint >> 6);
+            out[head++] = 0x80 | (codepoint & 0x3F);
+        } else if (codepoint < 0x10000) {
+            out[head++] = 0xE0 | (codepoint >> 12);
+            out[head++] = 0x80 | ((codepoint >> 6) & 0x3F);
+            out[head++] = 0x80 | (codepoint & 0x3F);
+        } else {
+            out[head++] = 0xF0 | (codepoint >> 18);
+            out[head++] = 0x80 | ((codepoint >> 12) & 0x3F);
+            out[head++] = 0x80 | ((codepoint >> 6) & 0x3F);
+            out[head++] = 0x80 | (codepoint & 0x3F);
+        }
+    }
+
+    if (head > 0 && sink != NULL) sink(ctx, out, head);
+    return total + head;
+}
+
+int piconfc_NDEF_utf16ToUTF8(const uint8_t *data, int len, char *dest, int destsize) {
+    // Measure first so malformed input leaves the destination untouched
+    int total = ndef_utf16Transcode(data, len, NULL, NULL);
+    if (total < 0) return -1;
+
+    NDEFCopySink copy = { dest, destsize, 0 };
+    ndef_utf16Transcode(data, len, ndef_copySink, &copy);
+    if (total > copy.head) copy.head = ndef_trimUTF8(dest, copy.head);
+    if (destsize > 0) dest[copy.head] = 0x00; // Null-terminate, even when truncated
+    return total;
+}
+
+bool piconfc_NDEF_parseText(const NDEFRecord *record, NDEFText *text) {
+    if (!ndef_isWellKnownType(record, "T") || record->data_length < 1) return false;
+
+    // The status byte holds the encoding flag and the length of the language code
+    const uint8_t *data = record->buffer + record->data_offset;
+    uint8_t status = data[0];
+    int language_len = status & 0x3F;
+    if (1 + language_len > record->data_length) return false;
+
+    text->utf16 = status & 0x80;
+    text->language.ptr = data + 1;
+    text->language.len = language_len;
+    text->text.ptr = data + 1 + language_len;
+    text->text.len = record->data_length - 1 - language_len;
+    return true;
+}
+
+int piconfc_NDEF_writeText(const NDEFText *text, NDEFSink sink, void *ctx) {
+    if (text->utf16) {
+        // Validate the whole text before the sink sees any of it
+        int total = ndef_utf16Transcode(text->text.ptr, text->text.len, NULL, NULL);
+        if (total < 0) return -1;
+        return ndef_utf16Transcode(text->text.ptr, text->text.len, sink, ctx);
+    }
+
+    // UTF-8 text is passed through as is once validated
+    if (!piconfc_NDEF_validateUTF8(text->text.ptr, text->text.len)) return -1;
+    if (text->text.len > 0) sink(ctx, text->text.ptr, text->text.len);
+    return text->text.len;
+}
+
+int piconfc_NDEF_copyText(const NDEFText *text, char *dest, int destsize) {
+    NDEFCopySink copy = { dest, destsize, 0 };
+    int total = piconfc_NDEF_writeText(text, ndef_copySink, &copy);
+    if (total < 0) return -1;
+    if (total > copy.head) copy.head = ndef_trimUTF8(dest, copy.head);
+    if (destsize > 0) dest[copy.head] = 0x00; // Null-terminate, even when truncated
+    return total;
+}
+
+bool piconfc_NDEF_builderAddText(NDEFBuilder *builder, const char *language, const char *text) {
+    int language_len = strlen(language);
+    int text_len = strlen(text);
+    if (language_len > 0x3F) {
+        builder->failed = true;
+        return false;
+    }
+
+    // Write the status byte, language code and UTF-8 text straight into the record payload
+    uint8_t *dest = ndef_builderReserve(builder, TNF_WELLKNOWN, (uint8_t *)"T", 1, NULL, 0, 1 + language_len + text_len);
+    if (dest == NULL) return false;
+    dest[0] = language_len; // UTF-8 encoding flag cleared
+    memcpy(dest + 1, language, language_len);
+    memcpy(dest + 1 + language_len, text, text_len);
+    return true;
+}
+
+bool piconfc_NDEF_parseSmartPoster(const NDEFIterator *parent, const NDEFRecord *record, NDEFSmartPoster *poster) {
+    NDEFIterator it;
+    NDEFRecord nested;
+
+    if (!ndef_isWellKnownType(record, "Sp")) return false;
+    if (!piconfc_NDEF_iteratorDescend(parent, record, &it)) return false;
+
+    poster->has_uri = false;
+    poster->has_title = false;
+    poster->action = NDEF_SP_ACTION_NONE;
+    poster->size = 0;
+    poster->type.ptr = NULL;
+    poster->type.len = 0;
+
+    // Walk the embedded message once, keeping views of the fields of interest
+    while (piconfc_NDEF_iteratorNext(&it, &nested)) {
+        const uint8_t *data = nested.buffer + nested.data_offset;
+        if (ndef_isWellKnownType(&nested, "U") && !poster->has_uri) {
+            poster->uri = nested;
+            poster->has_uri = true;
+        } else if (ndef_isWellKnownType(&nested, "T") && !poster->has_title) {
+            poster->has_title = piconfc_NDEF_parseText(&nested, &poster->title);
+        } else if (ndef_isWellKnownType(&nested, "act") && nested.data_length >= 1) {
+            poster->action = data[0];
+        } else if (ndef_isWellKnownType(&nested, "s") && nested.data_length >= 4) {
+            poster->size = ((uint32_t)data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+        } else if (ndef_isWellKnownType(&nested, "t")) {
+            poster->type = piconfc_NDEF_recordPayload(&nested);
         }
-        // Skip the prefix byte in the payload data and adjust data length
-        data_head += 1;
-        data_max -= 1;
     }
 
-    // Copy the actual payload data after the prefix
-    for (int j = 0; j < data_max; j++) {
-        final[head] = record->buffer[data_head + j];
-        head++;
+    // The URI record is the only mandatory part of a Smart Poster
+    return poster->has_uri;
+}
+
+// FNV-1a hash over the TNF and type of a record
+static uint32_t ndef_typeHash(enum TNF tnf, const uint8_t *type, int typelen) {
+    uint32_t hash = 2166136261u;
+    hash = (hash ^ (uint8_t)tnf) * 16777619u;
+    for (int i = 0; i < typelen; i++) hash = (hash ^ type[i]) * 16777619u;
+    return hash;
+}
+
+// Finds the slot holding (tnf, type), or the empty slot where it would go
+static NDEFDispatchEntry *ndef_dispatchSlot(NDEFDispatcher *dispatcher, uint32_t hash, enum TNF tnf, const uint8_t *type, int typelen) {
+    // Open addressing with linear probing; the table is never full, so an empty slot ends the probe
+    uint32_t slot = hash & (NDEF_DISPATCH_SLOTS - 1);
+    while (true) {
+        NDEFDispatchEntry *entry = &dispatcher->slots[slot];
+        if (entry->handler == NULL) return entry;
+        if (entry->hash == hash && entry->tnf == tnf && entry->type_length == typelen && memcmp(entry->type, type, typelen) == 0)
+            return entry;
+        slot = (slot + 1) & (NDEF_DISPATCH_SLOTS - 1);
     }
+}
+
+void piconfc_NDEF_dispatcherInit(NDEFDispatcher *dispatcher) {
+    memset(dispatcher, 0, sizeof(*dispatcher));
+}
+
+bool piconfc_NDEF_dispatcherRegister(NDEFDispatcher *dispatcher, enum TNF tnf, const uint8_t *type, uint8_t typelen, NDEFHandler handler, void *ctx) {
+    if (handler == NULL) return false;
+    uint32_t hash = ndef_typeHash(tnf, type, typelen);
+    NDEFDispatchEntry *entry = ndef_dispatchSlot(dispatcher, hash, tnf, type, typelen);
 
-    final[head] = 0x00; // Null-terminate the final URI string
+    // A new entry needs a free slot while keeping the table at most 3/4 full
+    if (entry->handler == NULL) {
+        if (dispatcher->count >= NDEF_DISPATCH_MAX_HANDLERS) return false;
+        dispatcher->count++;
+    }
 
-    *string = final; // Set the output string pointer to the allocated URI
+    // Registering the same (tnf, type) again replaces its handler
+    entry->hash = hash;
+    entry->tnf = tnf;
+    entry->type = type;
+    entry->type_length = typelen;
+    entry->handler = handler;
+    entry->ctx = ctx;
     return true;
-}
\ No newline at end of file
+}
+
+const NDEFDispatchEntry *piconfc_NDEF_dispatcherLookup(NDEFDispatcher *dispatcher, const NDEFRecord *record) {
+    const uint8_t *type = record->buffer + record->type_offset;
+    uint32_t hash = ndef_typeHash(record->tnf, type, record->type_length);
+    NDEFDispatchEntry *entry = ndef_dispatchSlot(dispatcher, hash, record->tnf, type, record->type_length);
+    return entry->handler != NULL ? entry : NULL;
+}
+
+int piconfc_NDEF_dispatch(NDEFDispatcher *dispatcher, uint8_t *buffer, int bufsize) {
+    NDEFIterator it;
+    NDEFRecord record;
+    int handled = 0;
+
+    // Walk the message once, handing each record with a registered type to its handler
+    piconfc_NDEF_iteratorInit(&it, buffer, bufsize);
+    while (piconfc_NDEF_iteratorNext(&it, &record)) {
+        const NDEFDispatchEntry *entry = piconfc_NDEF_dispatcherLookup(dispatcher, &record);
+        if (entry == NULL) continue;
+        entry->handler(entry->ctx, &record);
+        handled++;
+    }
+    return handled;
+}
+
+// Compares the TNF and type (by_id false) or the ID (by_id true) of a record with a key
+static bool ndef_indexMatches(const NDEFRecord *record, bool by_id, enum TNF tnf, const uint8_t *key, uint8_t keylen) {
+    if (by_id) return record->id_length == keylen && memcmp(record->buffer + record->id_offset, key, keylen) == 0;
+    return record->tnf == tnf && record->type_length == keylen && memcmp(record->buffer + record->type_offset, key, keylen) == 0;
+}
+
+// Probes one table of the index for a key. Returns the matching slot, or the empty slot that ends the probe.
+static NDEFIndexEntry *ndef_indexProbe(NDEFIndex *index, bool by_id, uint32_t hash, enum TNF tnf, const uint8_t *key, uint8_t keylen, NDEFRecord *record) {
+    NDEFIndexEntry *table = by_id ? index->by_id : index->by_type;
+    uint16_t tag = hash >> 16;
+    uint32_t slot = hash & (NDEF_INDEX_SLOTS - 1);
+
+    while (table[slot].offset != 0) {
+        // The stored hash bits filter out most collisions before the record is parsed
+        if (table[slot].tag == tag) {
+            piconfc_NDEF_parseRecord(index->buffer, index->bufsize, table[slot].offset - 1, record);
+            if (ndef_indexMatches(record, by_id, tnf, key, keylen)) return &table[slot];
+        }
+        slot = (slot + 1) & (NDEF_INDEX_SLOTS - 1);
+    }
+    return &table[slot];
+}
+
+// Adds a record to one table of the index unless an earlier record has the same key
+static void ndef_indexInsert(NDEFIndex *index, bool by_id, int *count, const NDEFRecord *record, int offset) {
+    NDEFRecord existing;
+    const uint8_t *key = record->buffer + (by_id ? record->id_offset : record->type_offset);
+    uint8_t keylen = by_id ? record->id_length : record->type_length;
+    enum TNF tnf = by_id ? TNF_EMPTY : record->tnf;
+    uint32_t hash = by_id ? ndef_typeHash(TNF_EMPTY, key, keylen) : ndef_typeHash(tnf, key, keylen);
+
+    NDEFIndexEntry *entry = ndef_indexProbe(index, by_id, hash, tnf, key, keylen, &existing);
+    if (entry->offset != 0) return; // The first record with a key wins
+
+    // Keep the table at most 3/4 full so probes stay short; later records fall back to a walk
+    if (*count >= NDEF_INDEX_MAX_RECORDS) {
+        index->complete = false;
+        return;
+    }
+    entry->offset = offset + 1;
+    entry->tag = hash >> 16;
+    (*count)++;
+}
+
+int piconfc_NDEF_indexBuild(NDEFIndex *index, uint8_t *buffer, int bufsize) {
+    NDEFIterator it;
+    NDEFRecord record;
+    int types = 0;
+    int ids = 0;
+
+    memset(index, 0, sizeof(*index));
+    index->buffer = buffer;
+    index->bufsize = bufsize;
+    index->complete = true;
+
+    // Index every record by type and, if it has one, by ID in a single pass
+    piconfc_NDEF_iteratorInit(&it, buffer, bufsize);
+    int offset = it.offset;
+    while (piconfc_NDEF_iteratorNext(&it, &record)) {
+        ndef_indexInsert(index, false, &types, &record, offset);
+        if (record.id_length > 0) ndef_indexInsert(index, true, &ids, &record, offset);
+        index->record_count++;
+        offset = it.offset;
+    }
+    return index->record_count;
+}
+
+// Finds a record by walking the message, for keys that did not fit in the index
+static bool ndef_indexWalk(NDEFIndex *index, bool by_id, enum TNF tnf, const uint8_t *key, uint8_t keylen, NDEFRecord *record) {
+    NDEFIterator it;
+    piconfc_NDEF_iteratorInit(&it, index->buffer, index->bufsize);
+    while (piconfc_NDEF_iteratorNext(&it, record)) {
+        if (ndef_indexMatches(record, by_id, tnf, key, keylen)) return true;
+    }
+    return false;
+}
+
+bool piconfc_NDEF_indexFindType(NDEFIndex *index, enum TNF tnf, const uint8_t *type, uint8_t typelen, NDEFRecord *record) {
+    NDEFIndexEntry *entry = ndef_indexProbe(index, false, ndef_typeHash(tnf, type, typelen), tnf, type, typelen, record);
+    if (entry->offset != 0) return true;
+    return !index->complete && ndef_indexWalk(index, false, tnf, type, typelen, record);
+}
+
+bool piconfc_NDEF_indexFindId(NDEFIndex *index, const uint8_t *id, uint8_t idlen, NDEFRecord *record) {
+    NDEFIndexEntry *entry = ndef_indexProbe(index, true, ndef_typeHash(TNF_EMPTY, id, idlen), TNF_EMPTY, id, idlen, record);
+    if (entry->offset != 0) return true;
+    return !index->complete && ndef_indexWalk(index, true, TNF_EMPTY, id, idlen, record);
+}
@@ -15,6 +15,19 @@ enum NTAG21X piconfc_NTAG_getModel(PicoNFCConfig *config) {
     return rbuf[2]; // Return the value in rbuf[2] which identifies the NTAG model.
 }
 
+uint8_t piconfc_NTAG_userPageEnd(enum NTAG21X model) {
+    switch (model) {
+        case MODEL_NTAG213:
+            return 0x28; // User memory is pages 0x04-0x27
+        case MODEL_NTAG215:
+            return 0x82; // User memory is pages 0x04-0x81
+        case MODEL_NTAG216:
+            return 0xE2; // User memory is pages 0x04-0xE1
+        default:
+            return 0; // Unknown model
+    }
+}
+
 bool piconfc_NTAG_read1Page(PicoNFCConfig *config, uint8_t page, uint8_t *buffer) {
     bool success = piconfc_NTAG_read4Pages(config, page, config->scratch);
     if (success) {
@@ -75,26 +88,20 @@ int piconfc_NTAG_readUserPages(PicoNFCConfig *config, uint8_t *buffer, unsigned
         printf("readingUserpages. model: %d\n", model);
     #endif
     
-    uint8_t end_userpages = 0;
-    switch (model) {
-        case MODEL_NTAG213:
-            end_userpages = 0x27; // End page for NTAG213
-            break;
-        case MODEL_NTAG215:
-            end_userpages = 0x81; // End page for NTAG215
-            break;
-        case MODEL_NTAG216:
-            end_userpages = 0xE1; // End page for NTAG216
-            break;
-        default:
-            return 0; // Unknown model, exit with 0 bytes read
-    }
+    uint8_t end_userpages = piconfc_NTAG_userPageEnd(model);
+    if (end_userpages == 0) return 0; // Unknown model, exit with 0 bytes read
 
-    for (int page = 4; page < end_userpages; page += 4) {
-        if (head + 16 >= bufsize) break; // Prevent buffer overflow
-        bool result = piconfc_NTAG_read4Pages(config, page, buffer + head); // Read 4 pages (16 bytes)
+    uint8_t group[16];
+    for (int page = NTAG_USER_START_PAGE; page < end_userpages; page += 4) {
+        // The last READ runs into the configuration pages; keep only user bytes that fit the buffer
+        int len = (end_userpages - page) * NTAG_PAGE_SIZE;
+        if (len > 16) len = 16;
+        if (len > (int)bufsize - head) len = bufsize - head;
+        if (len <= 0) break; // Prevent buffer overflow
+        bool result = piconfc_NTAG_read4Pages(config, page, group); // Read 4 pages (16 bytes)
         if (!result) break; // Stop reading if read fails
-        head += 16; // Increment head position in buffer by 16 bytes
+        memcpy(buffer + head, group, len);
+        head += len; // Increment head position in buffer
     }
     return head; // Total bytes read
 }
@@ -115,30 +122,249 @@ bool piconfc_NTAG_writePage(PicoNFCConfig *config, uint8_t page, uint8_t *buffer
     return success; // Return success status of the write operation
 }
 
+// Writes up to 4 pages and, when verification is enabled, confirms them with a single READ
+static bool ntag_writeGroup(PicoNFCConfig *config, uint8_t startpage, uint8_t *buffer, int npages) {
+    for (int i = 0; i < npages; i++) {
+        if (!piconfc_NTAG_writePage(config, startpage + i, buffer + i * NTAG_PAGE_SIZE)) return false;
+    }
+    if (!config->verify_writes) return true;
+
+    uint8_t readback[16];
+    for (int attempt = 0; ; attempt++) {
+        // One READ returns all 4 pages of the group
+        if (!piconfc_NTAG_read4Pages(config, startpage, readback)) return false;
+
+        // Collect the pages that did not make it onto the tag
+        uint8_t mismatched = 0;
+        for (int i = 0; i < npages; i++) {
+            if (memcmp(readback + i * NTAG_PAGE_SIZE, buffer + i * NTAG_PAGE_SIZE, NTAG_PAGE_SIZE) != 0)
+                mismatched |= 1 << i;
+        }
+        if (mismatched == 0) return true;
+        if (attempt == NTAG_WRITE_RETRIES) return false;
+
+        #ifdef NTAG_DEBUG
+            printf("verify mismatch at page %d, mask %02X\n", startpage, mismatched);
+        #endif
+
+        // Rewrite only the mismatched pages
+        for (int i = 0; i < npages; i++) {
+            if (!(mismatched & (1 << i))) continue;
+            if (!piconfc_NTAG_writePage(config, startpage + i, buffer + i * NTAG_PAGE_SIZE)) return false;
+        }
+    }
+}
+
+bool piconfc_NTAG_writePages(PicoNFCConfig *config, uint8_t startpage, uint8_t *buffer, int npages) {
+    for (int i = 0; i < npages; i += 4) {
+        int group = npages - i < 4 ? npages - i : 4;
+        // Write (and optionally verify) the run 4 pages at a time, stopping at the first failure
+        if (!ntag_writeGroup(config, startpage + i, buffer + i * NTAG_PAGE_SIZE, group)) return false;
+    }
+    return true;
+}
+
+// Image pages of the largest supported tag
+#define NTAG_MAX_USER_PAGES (NTAG_MAX_USER_BYTES / NTAG_PAGE_SIZE)
+
+// How an image maps onto the tag: bytes owned by the tag and the page holding the NDEF length
+typedef struct {
+    uint8_t reserved[NTAG_MAX_USER_PAGES]; // Per image page, bit n set if byte n is reserved
+    bool has_reserved;                     // Whether any byte of the image is reserved
+    int length_page;                       // Image page holding the NDEF TLV length, or -1
+    int length_byte;                       // Byte within length_page holding the length
+} NTAGLayout;
+
+// Walks the TLVs of an image to find its reserved bytes and the page to write last.
+// Returns false, leaving an empty layout, if the image is not 1 to NTAG_MAX_USER_PAGES pages long.
+static bool ntag_planLayout(NTAGLayout *layout, uint8_t *image, int npages) {
+    layout->has_reserved = false;
+    layout->length_page = -1;
+    layout->length_byte = 0;
+    if (npages <= 0 || npages > NTAG_MAX_USER_PAGES) return false;
+    memset(layout->reserved, 0, npages);
+
+    struct TLVMap map;
+    piconfc_NDEF_walkTLV(&map, image, npages * NTAG_PAGE_SIZE, 0);
+
+    // Mark every image byte covered by a Lock Control or Memory Control area
+    int base = NTAG_USER_START_PAGE * NTAG_PAGE_SIZE; // Areas use absolute tag addresses
+    for (int i = 0; i < map.reserved_count; i++) {
+        int start = map.reserved[i].address - base;
+        int end = start + map.reserved[i].length;
+        if (start < 0) start = 0;
+        if (end > npages * NTAG_PAGE_SIZE) end = npages * NTAG_PAGE_SIZE;
+        for (int b = start; b < end; b++) {
+            layout->reserved[b / NTAG_PAGE_SIZE] |= 1 << (b % NTAG_PAGE_SIZE);
+            layout->has_reserved = true;
+        }
+    }
+
+    // The byte after the NDEF TLV tag holds the length, which is published last
+    if (map.ndef_block != -1) {
+        int length_offset = map.blocks[map.ndef_block].offset + 1;
+        if (!layout->reserved[length_offset / NTAG_PAGE_SIZE]) {
+            layout->length_page = length_offset / NTAG_PAGE_SIZE;
+            layout->length_byte = length_offset % NTAG_PAGE_SIZE;
+        }
+    }
+
+    #ifdef NTAG_DEBUG
+        printf("layout: %d reserved areas, length page %d\n", map.reserved_count, layout->length_page);
+    #endif
+    return true;
+}
+
+// Builds a page from the image, keeping the tag's current bytes where they are reserved
+static void ntag_mergePage(uint8_t *out, uint8_t *image_page, uint8_t *current_page, uint8_t mask) {
+    for (int b = 0; b < NTAG_PAGE_SIZE; b++) {
+        out[b] = (mask & (1 << b)) ? current_page[b] : image_page[b];
+    }
+}
+
+// Builds the length page with an empty NDEF TLV: length 0 followed by a terminator
+static void ntag_emptyLengthPage(NTAGLayout *layout, uint8_t *length_page, uint8_t *out) {
+    memcpy(out, length_page, NTAG_PAGE_SIZE);
+    out[layout->length_byte] = 0x00;
+    if (layout->length_byte + 1 < NTAG_PAGE_SIZE) out[layout->length_byte + 1] = NDEF_TLV_TERMINATOR;
+}
+
+// Writes an image from page 4, skipping reserved bytes and publishing the NDEF length last
+static bool ntag_writeImage(PicoNFCConfig *config, uint8_t *image, int npages, NTAGLayout *layout) {
+    if (npages <= 0 || npages > NTAG_MAX_USER_PAGES) return false;
+    static uint8_t merged[NTAG_MAX_USER_BYTES];
+    uint8_t *source = image;
+
+    // Partially reserved pages are rewritten with the bytes the tag already holds
+    if (layout->has_reserved) {
+        memcpy(merged, image, npages * NTAG_PAGE_SIZE);
+        for (int p = 0; p < npages; p++) {
+            uint8_t mask = layout->reserved[p];
+            if (mask == 0 || mask == 0x0F) continue;
+            uint8_t current[NTAG_PAGE_SIZE];
+            if (!piconfc_NTAG_read1Page(config, NTAG_USER_START_PAGE + p, current)) return false;
+            ntag_mergePage(merged + p * NTAG_PAGE_SIZE, image + p * NTAG_PAGE_SIZE, current, mask);
+        }
+        source = merged;
+    }
+
+    // The zero-length write is only needed when other pages follow
+    int length_page = layout->length_page;
+    int others = 0;
+    for (int p = 0; p < npages; p++) {
+        if (p != length_page && layout->reserved[p] != 0x0F) others++;
+    }
+    if (length_page != -1 && others > 0) {
+        uint8_t empty[NTAG_PAGE_SIZE];
+        ntag_emptyLengthPage(layout, source + length_page * NTAG_PAGE_SIZE, empty);
+        if (!piconfc_NTAG_writePages(config, NTAG_USER_START_PAGE + length_page, empty, 1)) return false;
+    }
+
+    // Write the runs of pages between fully reserved pages and the length page
+    int run_start = -1;
+    for (int p = 0; p <= npages; p++) {
+        bool writable = p < npages && p != length_page && layout->reserved[p] != 0x0F;
+        if (writable && run_start == -1) run_start = p;
+        if (!writable && run_start != -1) {
+            uint8_t *run = source + run_start * NTAG_PAGE_SIZE;
+            if (!piconfc_NTAG_writePages(config, NTAG_USER_START_PAGE + run_start, run, p - run_start)) return false;
+            run_start = -1;
+        }
+    }
+
+    // Publish the message by writing the real length
+    if (length_page == -1) return true;
+    return piconfc_NTAG_writePages(config, NTAG_USER_START_PAGE + length_page, source + length_page * NTAG_PAGE_SIZE, 1);
+}
+
 bool piconfc_NTAG_writeUserData(PicoNFCConfig *config, uint8_t * buffer, unsigned int bufsize) {
     enum NTAG21X model = piconfc_NTAG_getModel(config);
-    int head = 0;
 
     if (model == 0x00) model = MODEL_NTAG213; // Default to NTAG213 if model detection fails
-    uint8_t end_userpages = 0;
-    switch (model) {
-        case MODEL_NTAG213:
-            end_userpages = 0x27; // End page for NTAG213
-            break;
-        case MODEL_NTAG215:
-            end_userpages = 0x81; // End page for NTAG215
-            break;
-        case MODEL_NTAG216:
-            end_userpages = 0xE1; // End page for NTAG216
+    uint8_t end_userpages = piconfc_NTAG_userPageEnd(model);
+    if (end_userpages == 0) return false; // The capability container names a tag that is not an NTAG21x
+
+    // Write whole pages starting from page 4 up to the end_userpages limit
+    int npages = end_userpages - NTAG_USER_START_PAGE;
+    int available = bufsize / NTAG_PAGE_SIZE;
+    bool filled = available >= npages; // Report if the buffer runs out before the user memory
+    if (!filled) npages = available;
+    if (npages <= 0) return false;
+
+    // Avoid the areas announced by control TLVs and publish any NDEF TLV last
+    NTAGLayout layout;
+    if (!ntag_planLayout(&layout, buffer, npages)) return false;
+    return ntag_writeImage(config, buffer, npages, &layout) && filled;
+}
+
+bool piconfc_NTAG_writeNDEF(PicoNFCConfig *config, uint8_t *image, int len) {
+    if (len <= 0 || len % NTAG_PAGE_SIZE != 0 || len > NTAG_MAX_USER_BYTES) return false;
+    int npages = len / NTAG_PAGE_SIZE;
+
+    NTAGLayout layout;
+    if (!ntag_planLayout(&layout, image, npages)) return false;
+    return ntag_writeImage(config, image, npages, &layout);
+}
+
+int piconfc_NTAG_recoverNDEF(PicoNFCConfig *config, uint8_t *image, int len) {
+    if (len <= 0 || len % NTAG_PAGE_SIZE != 0 || len > NTAG_MAX_USER_BYTES) return -1;
+    int npages = len / NTAG_PAGE_SIZE;
+
+    NTAGLayout layout;
+    if (!ntag_planLayout(&layout, image, npages)) return -1;
+    int length_page = layout.length_page;
+
+    static uint8_t current[NTAG_MAX_USER_BYTES + 16]; // Room for the last READ to overrun the image
+    uint8_t missing[(NTAG_MAX_USER_PAGES + 7) / 8] = { 0 }; // One bit per image page
+    int body_mismatches = 0;
+    int writes = 0;
+
+    // Read the tag 4 pages per READ and compare the bytes the image owns
+    for (int p = 0; p < npages; p += 4) {
+        if (!piconfc_NTAG_read4Pages(config, NTAG_USER_START_PAGE + p, current + p * NTAG_PAGE_SIZE)) return -1;
+    }
+    for (int p = 0; p < npages; p++) {
+        for (int b = 0; b < NTAG_PAGE_SIZE; b++) {
+            if (layout.reserved[p] & (1 << b)) continue;
+            if (current[p * NTAG_PAGE_SIZE + b] == image[p * NTAG_PAGE_SIZE + b]) continue;
+            missing[p / 8] |= 1 << (p % 8);
+            if (p != length_page) body_mismatches++;
             break;
+        }
     }
-    
-    // Write data starting from page 4 up to the end_userpages limit
-    for (int i = 4; i < end_userpages; i++) {
-        if (head + 4 > bufsize) return false; // Insufficient buffer data to write 4 bytes
-        bool result = piconfc_NTAG_writePage(config, i, buffer+head); // Write 4 bytes to the current page
-        if (!result) return false; // Return false if write fails
-        head += 4; // Move to the next 4 bytes in the buffer
-    }
-    return true; // Return true if all pages were written successfully
-}
\ No newline at end of file
+    bool length_matches = length_page == -1 || !(missing[length_page / 8] & (1 << (length_page % 8)));
+
+    #ifdef NTAG_DEBUG
+        printf("recoverNDEF: length page %s, %d body pages missing\n", length_matches ? "ok" : "differs", body_mismatches);
+    #endif
+
+    uint8_t page[NTAG_PAGE_SIZE];
+    if (body_mismatches == 0) {
+        // Either the tag is complete or only the final length write was lost
+        if (length_matches) return 0;
+        ntag_mergePage(page, image + length_page * NTAG_PAGE_SIZE, current + length_page * NTAG_PAGE_SIZE, layout.reserved[length_page]);
+        return piconfc_NTAG_writePages(config, NTAG_USER_START_PAGE + length_page, page, 1) ? 1 : -1;
+    }
+
+    // Body pages are missing: make sure the tag advertises an empty message while they are written
+    if (length_page != -1 && current[length_page * NTAG_PAGE_SIZE + layout.length_byte] != 0x00) {
+        ntag_mergePage(page, image + length_page * NTAG_PAGE_SIZE, current + length_page * NTAG_PAGE_SIZE, layout.reserved[length_page]);
+        ntag_emptyLengthPage(&layout, page, page);
+        if (!piconfc_NTAG_writePages(config, NTAG_USER_START_PAGE + length_page, page, 1)) return -1;
+        writes++;
+    }
+
+    // Rewrite only the body pages that differ from the image
+    for (int p = 0; p < npages; p++) {
+        if (p == length_page || !(missing[p / 8] & (1 << (p % 8)))) continue;
+        ntag_mergePage(page, image + p * NTAG_PAGE_SIZE, current + p * NTAG_PAGE_SIZE, layout.reserved[p]);
+        if (!piconfc_NTAG_writePages(config, NTAG_USER_START_PAGE + p, page, 1)) return -1;
+        writes++;
+    }
+
+    // Publish the completed message
+    if (length_page == -1) return writes;
+    ntag_mergePage(page, image + length_page * NTAG_PAGE_SIZE, current + length_page * NTAG_PAGE_SIZE, layout.reserved[length_page]);
+    if (!piconfc_NTAG_writePages(config, NTAG_USER_START_PAGE + length_page, page, 1)) return -1;
+    return writes + 1;
+}
@@ -12,12 +12,12 @@ float piconfc_PN532_firmwareVersion(PicoNFCConfig *config) {
     uint8_t command = PN532_COMMAND_GETFIRMWAREVERSION;
     
     // Send the GETFIRMWAREVERSION command and check for acknowledgment
-    if (!piconfc_I2C_sendcommand_andack(config->i2c_block, &command, 1, DEFAULT_TIMEOUT)) {
+    if (!piconfc_I2C_sendcommand_andack(&config->transport, &command, 1, DEFAULT_TIMEOUT)) {
         return -1.0;  // Return -1.0 if there was an error sending the command
     }
 
     // Parse the response and check for success
-    int success = piconfc_I2C_parseresponse(config->i2c_block, config->scratch, 5);
+    int success = piconfc_I2C_parseresponse(&config->transport, config->scratch, 5);
     if (!success) {
         return -1.0;  // Return -1.0 if parsing the response failed
     }
@@ -30,18 +30,18 @@ bool piconfc_PN532_RFRegulationTest(PicoNFCConfig *config) {
     uint8_t buffer[2] = { PN532_COMMAND_RFREGULATIONTEST, 0 };
 
     // Send the RF Regulation Test command to the PN532
-    piconfc_I2C_writecommand(config->i2c_block, buffer, 2);
+    piconfc_I2C_writecommand(&config->transport, buffer, 2);
 
     // Short delay to allow the command to process
     sleep_ms(1);
 
     // Wait for the PN532 to become ready
-    if (!piconfc_I2C_waitready(config->i2c_block, DEFAULT_TIMEOUT)) {
+    if (!piconfc_I2C_waitready(&config->transport, DEFAULT_TIMEOUT)) {
         return false;
     }
 
     // Check for acknowledgment from the PN532
-    if (!piconfc_I2C_readack(config->i2c_block)) {
+    if (!piconfc_I2C_readack(&config->transport)) {
         return false;
     }
 
@@ -60,12 +60,12 @@ bool piconfc_PN532_SAMConfiguration(PicoNFCConfig *config) {
     };
 
     // Send the SAM Configuration command and wait for acknowledgment
-    if (!piconfc_I2C_sendcommand_andack(config->i2c_block, buffer, sizeof(buffer), DEFAULT_TIMEOUT)) {
+    if (!piconfc_I2C_sendcommand_andack(&config->transport, buffer, sizeof(buffer), DEFAULT_TIMEOUT)) {
         return false;
     }
     
     // Parse the response and check the return command value
-    uint8_t len = piconfc_I2C_parseresponse(config->i2c_block, config->scratch, 1);
+    uint8_t len = piconfc_I2C_parseresponse(&config->transport, config->scratch, 1);
 
     return config->scratch[0] == 0x15; // Expected response indicating success
 }
@@ -80,15 +80,39 @@ bool piconfc_PN532_setPassiveActivationRetries(PicoNFCConfig *config, uint8_t re
     };
 
     // Send the RF Configuration command and wait for acknowledgment
-    if (!piconfc_I2C_sendcommand_andack(config->i2c_block, buffer, sizeof(buffer), DEFAULT_TIMEOUT)) {
+    if (!piconfc_I2C_sendcommand_andack(&config->transport, buffer, sizeof(buffer), DEFAULT_TIMEOUT)) {
         return false;
     }
 
     // Parse the response and check for a valid response length
-    uint8_t len = piconfc_I2C_parseresponse(config->i2c_block, config->scratch, 1);
+    uint8_t len = piconfc_I2C_parseresponse(&config->transport, config->scratch, 1);
     return len == 1;
 }
 
+bool piconfc_PN532_setSerialBaudRate(PicoNFCConfig *config, uint32_t baudrate) {
+    // Rates in the order of their SetSerialBaudRate codes
+    static const uint32_t rates[] = { 9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600 };
+    int code = -1;
+    for (int i = 0; i < (int)(sizeof(rates) / sizeof(rates[0])); i++) {
+        if (rates[i] == baudrate) code = i;
+    }
+    if (code < 0) return false; // Not a rate the PN532 supports
+
+    uint8_t buffer[] = { PN532_COMMAND_SETSERIALBAUDRATE, code };
+
+    // Send the Set Serial Baud Rate command and wait for acknowledgment
+    if (!piconfc_I2C_sendcommand_andack(&config->transport, buffer, sizeof(buffer), DEFAULT_TIMEOUT)) {
+        return false;
+    }
+
+    // Parse the response and check the return command value
+    uint8_t len = piconfc_I2C_parseresponse(&config->transport, config->scratch, 1);
+    if (len != 1 || config->scratch[0] != PN532_COMMAND_SETSERIALBAUDRATE + 1) return false;
+
+    // The PN532 only switches once the host has acknowledged the response
+    return config->transport.write(&config->transport, PN532_ACK, sizeof(PN532_ACK));
+}
+
 bool piconfc_PN532_readPassiveTargetID(PicoNFCConfig *config, uint8_t baudrate, uint8_t *uid, uint8_t *uid_len, uint16_t timeout) {
     uint8_t buffer[] = {
         PN532_COMMAND_INLISTPASSIVETARGET,
@@ -97,12 +121,12 @@ bool piconfc_PN532_readPassiveTargetID(PicoNFCConfig *config, uint8_t baudrate,
     };
 
     // Send the InListPassiveTarget command and wait for acknowledgment
-    if (!piconfc_I2C_sendcommand_andack(config->i2c_block, buffer, sizeof(buffer), timeout)) {
+    if (!piconfc_I2C_sendcommand_andack(&config->transport, buffer, sizeof(buffer), timeout)) {
         return false;
     }
 
     // Parse the response and check for valid response length and card detection status
-    uint8_t len = piconfc_I2C_parseresponse(config->i2c_block, config->scratch, 20);
+    uint8_t len = piconfc_I2C_parseresponse(&config->transport, config->scratch, 20);
     if (len == 0 || config->scratch[1] == 0) {
         return false;  // Return false if no card was detected
     }
@@ -139,12 +163,12 @@ bool piconfc_PN532_initiatorDataExchange(PicoNFCConfig *config, uint8_t *send, u
     memcpy(cmdbuf + 2, send, sendlen);
 
     // Send the InDataExchange command and wait for acknowledgment
-    if (!piconfc_I2C_sendcommand_andack(config->i2c_block, cmdbuf, sizeof(cmdbuf), DEFAULT_TIMEOUT)) {
+    if (!piconfc_I2C_sendcommand_andack(&config->transport, cmdbuf, sizeof(cmdbuf), DEFAULT_TIMEOUT)) {
         return false;
     }
 
     // Parse the response, expecting rbuf_size + 2 bytes (command ID + status byte + data)
-    uint8_t len = piconfc_I2C_parseresponse(config->i2c_block, config->scratch, rbuf_size + 2);
+    uint8_t len = piconfc_I2C_parseresponse(&config->transport, config->scratch, rbuf_size + 2);
 
     // Check for valid command ID and status byte
     if (config->scratch[0] != 0x41 || config->scratch[1] != 0) {
@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <string.h>
+#include "hardware/spi.h"
+#include "pico/stdlib.h"
+
+#include "piconfc_SPI.h"
+#include "piconfc_PN532.h"
+
+// Reverses the bits of a byte: the PN532 is LSB first, the RP2040 SPI MSB first
+static uint8_t spibus_reverse(uint8_t b) {
+    b = (b & 0xF0) >> 4 | (b & 0x0F) << 4; // Swap nibbles
+    b = (b & 0xCC) >> 2 | (b & 0x33) << 2; // Swap pairs
+    b = (b & 0xAA) >> 1 | (b & 0x55) << 1; // Swap bits
+    return b;
+}
+
+// Runs one transaction with chip select held low: the operation byte, then len bytes each way
+static bool spibus_transfer(PicoNFCSPIBus *bus, uint8_t op, const uint8_t *out, uint8_t *in, int len) {
+    uint8_t tx[len + 1];
+    uint8_t rx[len + 1];
+
+    // Operation byte first, then the data (or zeros to clock in a read), in PN532 bit order
+    tx[0] = spibus_reverse(op);
+    for (int i = 0; i < len; i++) tx[i + 1] = out != NULL ? spibus_reverse(out[i]) : 0;
+
+    gpio_put(bus->cs_pin, 0);
+    int n = spi_write_read_blocking(bus->block, tx, rx, len + 1);
+    gpio_put(bus->cs_pin, 1);
+
+    // Whatever the PN532 shifted out during the operation byte is meaningless
+    if (in != NULL) {
+        for (int i = 0; i < len; i++) in[i] = spibus_reverse(rx[i + 1]);
+    }
+
+    #ifdef SPI_DEBUG
+        printf("spi %02X: ", op);
+        printhex(in != NULL ? in : tx + 1, len);
+    #endif
+    return n == len + 1;
+}
+
+// SPI backend of the transport seam; ctx is the PicoNFCSPIBus
+static bool spibus_isready(PicoNFCTransport *transport) {
+    uint8_t status = 0;
+    // A status read returns the ready indicator after the operation byte
+    spibus_transfer(transport->ctx, PN532_SPI_STATREAD, NULL, &status, 1);
+    return status == PN532_SPI_READY;
+}
+
+static bool spibus_write(PicoNFCTransport *transport, const uint8_t *data, int len) {
+    return spibus_transfer(transport->ctx, PN532_SPI_DATAWRITE, data, NULL, len);
+}
+
+static bool spibus_read(PicoNFCTransport *transport, uint8_t *data, int len) {
+    // Unlike I2C, the frame follows the operation byte with no status byte in front
+    return spibus_transfer(transport->ctx, PN532_SPI_DATAREAD, NULL, data, len);
+}
+
+void piconfc_SPI_init(PicoNFCSPIBus *bus, spi_inst_t *block, uint8_t sck_pin, uint8_t mosi_pin, uint8_t miso_pin, uint8_t cs_pin) {
+    bus->block = block;
+    bus->cs_pin = cs_pin;
+
+    // Initialize the SPI instance in mode 0; bit order is handled in software
+    spi_init(block, PICONFC_SPI_FREQ);
+    spi_set_format(block, 8, SPI_CPOL_0, SPI_CPHA_0, SPI_MSB_FIRST);
+
+    // Configure clock and data pins for SPI functionality
+    gpio_set_function(sck_pin, GPIO_FUNC_SPI);
+    gpio_set_function(mosi_pin, GPIO_FUNC_SPI);
+    gpio_set_function(miso_pin, GPIO_FUNC_SPI);
+
+    // Chip select is driven by hand so it spans a whole transaction
+    gpio_init(cs_pin);
+    gpio_set_dir(cs_pin, GPIO_OUT);
+    gpio_put(cs_pin, 1);
+
+    // Wake the PN532 with a falling edge on chip select and give its oscillator time to start
+    gpio_put(cs_pin, 0);
+    sleep_ms(2);
+    gpio_put(cs_pin, 1);
+}
+
+void piconfc_SPI_transport(PicoNFCTransport *transport, PicoNFCSPIBus *bus) {
+    transport->isready = spibus_isready;
+    transport->write = spibus_write;
+    transport->read = spibus_read;
+    transport->waitready = NULL; // Poll the status every millisecond
+    transport->ctx = bus;
+}